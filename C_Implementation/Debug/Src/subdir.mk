@@ -9,14 +9,38 @@ C_SRCS += \
 ../Src/syscalls.c \
 ../Src/sysmem.c \
 ../Src/gpio.c \
-../Src/tasks.c
+../Src/tasks.c \
+../Src/timer.c \
+../Src/mempool.c \
+../Src/mlfq.c \
+../Src/job.c \
+../Src/uart.c \
+../Src/shell.c \
+../Src/pipeline.c \
+../Src/log.c \
+../Src/boot.c \
+../Src/profiler.c \
+../Src/svc.c \
+../Src/mpu.c
 
 OBJS += \
 ./Src/main.o \
 ./Src/syscalls.o \
 ./Src/sysmem.o \
 ./Src/gpio.o \
-./Src/tasks.o 
+./Src/tasks.o \
+./Src/timer.o \
+./Src/mempool.o \
+./Src/mlfq.o \
+./Src/job.o \
+./Src/uart.o \
+./Src/shell.o \
+./Src/pipeline.o \
+./Src/log.o \
+./Src/boot.o \
+./Src/profiler.o \
+./Src/svc.o \
+./Src/mpu.o 
 
 
 C_DEPS += \
@@ -24,7 +48,19 @@ C_DEPS += \
 ./Src/syscalls.d \
 ./Src/sysmem.d \
 ./Src/tasks.d \
-./Src/gpio.d 
+./Src/gpio.d \
+./Src/timer.d \
+./Src/mempool.d \
+./Src/mlfq.d \
+./Src/job.d \
+./Src/uart.d \
+./Src/shell.d \
+./Src/pipeline.d \
+./Src/log.d \
+./Src/boot.d \
+./Src/profiler.d \
+./Src/svc.d \
+./Src/mpu.d 
 
 
 # Each subdirectory must supply rules for building sources it contributes
@@ -34,7 +70,7 @@ Src/%.o Src/%.su Src/%.cyclo: ../Src/%.c Src/subdir.mk
 clean: clean-Src
 
 clean-Src:
-	-$(RM) ./Src/main.cyclo ./Src/main.d ./Src/main.o ./Src/main.su ./Src/syscalls.cyclo ./Src/syscalls.d ./Src/syscalls.o ./Src/syscalls.su ./Src/sysmem.cyclo ./Src/sysmem.d ./Src/sysmem.o ./Src/sysmem.su ./Src/gpio* ./Src/tasks*
+	-$(RM) ./Src/main.cyclo ./Src/main.d ./Src/main.o ./Src/main.su ./Src/syscalls.cyclo ./Src/syscalls.d ./Src/syscalls.o ./Src/syscalls.su ./Src/sysmem.cyclo ./Src/sysmem.d ./Src/sysmem.o ./Src/sysmem.su ./Src/gpio* ./Src/tasks* ./Src/timer* ./Src/mempool* ./Src/mlfq* ./Src/job* ./Src/uart* ./Src/shell* ./Src/pipeline* ./Src/log* ./Src/boot* ./Src/profiler* ./Src/svc* ./Src/mpu*
 
 .PHONY: clean-Src
 
@@ -0,0 +1,70 @@
+/**
+ * @file boot.h
+ * @brief Boot instrumentation and deferred initialization.
+ *
+ * This file contains the boot phase definitions and the function prototypes
+ * of the boot module. `Reset_Handler` starts the DWT cycle counter before
+ * anything else, so every phase is timestamped in CPU cycles since reset :
+ *
+ * | Mark                     | Recorded by    | Reached when                          |
+ * |--------------------------|----------------|---------------------------------------|
+ * | BOOT_MARK_SYSTEM_INIT    | Reset_Handler  | SystemInit returned                   |
+ * | BOOT_MARK_DATA           | Reset_Handler  | .data copied from flash               |
+ * | BOOT_MARK_BSS            | Reset_Handler  | .bss zeroed                           |
+ * | BOOT_MARK_CONSTRUCTORS   | Reset_Handler  | static constructors run, main entered |
+ * | BOOT_MARK_DRIVERS        | main           | boot critical drivers ready           |
+ * | BOOT_MARK_TASKS          | main           | task stacks and TCBs built            |
+ * | BOOT_MARK_FIRST_TASK     | main           | first task dispatched                 |
+ * | BOOT_MARK_POST_START     | idle task      | deferred initialization done          |
+ *
+ * The shell `boot` command prints them. Initialization that the first tasks
+ * do not need goes in `boot_post_start`, which runs the first time the
+ * system is idle instead of delaying the first task.
+ *
+ * @author Bilel
+ * @date 2024-10-28
+ */
+
+#include <stdint.h>
+
+// Mark indexes, the first four are hard coded in startup_stm32f407vgtx.s
+#define BOOT_MARK_SYSTEM_INIT   0U
+#define BOOT_MARK_DATA          1U
+#define BOOT_MARK_BSS           2U
+#define BOOT_MARK_CONSTRUCTORS  3U
+#define BOOT_MARK_DRIVERS       4U
+#define BOOT_MARK_TASKS         5U
+#define BOOT_MARK_FIRST_TASK    6U
+#define BOOT_MARK_POST_START    7U
+#define BOOT_MARKS              8U
+
+/**
+ * @brief Records the current cycle count for a boot phase.
+ *
+ * @param mark One of the BOOT_MARK_* values.
+ * @return None
+ */
+void boot_mark(uint8_t mark);
+
+/**
+ * @brief Returns the cycle count recorded for a boot phase.
+ *
+ * @param mark One of the BOOT_MARK_* values.
+ * @param cycles Receives the CPU cycles from reset to the mark.
+ *
+ * @return 1 if the phase was reached, 0 otherwise.
+ */
+uint8_t boot_cycles(uint8_t mark, uint32_t *cycles);
+
+/**
+ * @brief Runs the initialization deferred until after the scheduler started.
+ *
+ * Called once by the idle task, which may run late, or never, while the
+ * other tasks keep the CPU busy. Only what no task waits for belongs here :
+ * it starts the sampling profiler when `PROFILER_ENABLE` is set. The drivers
+ * the tasks use, USART2 included, are started by `main`.
+ *
+ * @param None
+ * @return None
+ */
+void boot_post_start(void);
@@ -60,6 +60,4 @@ void gpio_init(void);
 void toggle_gpio_pin(uint32_t pin);
 
 
-//void delay(uint32_t);
-
 
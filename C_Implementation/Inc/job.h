@@ -0,0 +1,149 @@
+/**
+ * @file job.h
+ * @brief Stackless cooperative jobs for the Embedded Scheduler Project.
+ *
+ * This file defines the Job structure, the macros used to write jobs and the
+ * function prototypes of the job executor.
+ *
+ * Jobs are small state machines written as protothreads : a job function
+ * runs until it waits, then returns to the executor, and resumes after the
+ * waiting point at its next call. All jobs are dispatched by a single
+ * preemptive task (`JOB_EXECUTOR_TASK`) and share its stack, so a job costs
+ * a few bytes of RAM and switching between jobs costs no PendSV.
+ *
+ * Local variables of a job function do not survive a wait, state that must
+ * persist belongs in the Job `context`. A job function must not call
+ * `task_delay` or other blocking task services, it would block every job.
+ *
+ * Example :
+ * @code
+ * static Job blink_job;
+ *
+ * static uint8_t blink(Job *job) {
+ *   JOB_BEGIN(job);
+ *   while (1) {
+ *     toggle_gpio_pin(GPIO_PIN_D15);
+ *     JOB_DELAY(job, 8);
+ *   }
+ *   JOB_END(job);
+ * }
+ *
+ * job_register(&blink_job, blink, 1, NULL);
+ * @endcode
+ *
+ * @author Bilel
+ * @date 2024-10-28
+ */
+
+#include <stdint.h>
+
+#define JOB_MAX_JOBS    128U        // Maximum number of registered jobs
+
+// Job states, also the values returned by a job function
+#define JOB_READY       0x0         // Runnable
+#define JOB_DELAYED     0x1         // Sleeping until wake_tick
+#define JOB_WAITING     0x2         // Waiting for job_notify
+#define JOB_DONE        0x3         // Finished, removed from the executor
+
+typedef struct Job Job;
+
+/**
+ * @brief Body of a job, returns the state the job is left in.
+ */
+typedef uint8_t (*JobFunction)(Job *job);
+
+/**
+ * @brief Represents a job dispatched by the job executor.
+ *
+ * This structure holds everything a job needs between two calls : the point
+ * where its function resumes, its scheduling state and its user context.
+ */
+struct Job
+{
+    uint16_t resume_point;       // Line to resume at, 0 to start from JOB_BEGIN
+    uint8_t priority;            // Higher values are dispatched first
+    uint8_t job_state;           // One of the JOB_* states
+    uint8_t notified;            // Set by job_notify, consumed by JOB_WAIT_NOTIFY
+    uint32_t wake_tick;          // Tick at which a delayed job becomes ready
+    JobFunction job_function;    // Job body
+    void *context;               // User data of the job
+};
+
+/*
+ * Protothread macros. They expand to a switch statement on resume_point, so
+ * they must all be used directly in the job function, not in a nested switch,
+ * and at most one of them may appear on a source line.
+ */
+#define JOB_BEGIN(job)          switch ((job)->resume_point) { case 0:
+
+#define JOB_END(job)            } (job)->resume_point = 0; return JOB_DONE
+
+// Gives the other jobs of the same priority a chance to run
+#define JOB_YIELD(job)          do { (job)->resume_point = __LINE__; return JOB_READY; \
+                                     case __LINE__:; } while (0)
+
+// Sleeps for `ticks` system ticks, same semantics as task_delay
+#define JOB_DELAY(job, ticks)   do { (job)->resume_point = __LINE__; return job_sleep((job), (ticks)); \
+                                     case __LINE__:; } while (0)
+
+// Waits until job_notify is called on the job, returns at once if a notification is pending
+#define JOB_WAIT_NOTIFY(job)    do { (job)->resume_point = __LINE__; case __LINE__: \
+                                     if (!job_take_notify(job)) return JOB_WAITING; } while (0)
+
+/**
+ * @brief Registers a job with the executor.
+ *
+ * A job that reaches `JOB_END` leaves the executor and frees its entry, the
+ * same Job may then be registered again.
+ *
+ * @param job The job to register, it must stay valid as long as it runs.
+ * @param job_function The body of the job.
+ * @param priority The priority of the job, higher values are dispatched first.
+ * @param context User data, available to the job as `job->context`.
+ *
+ * @return 0 on success, -1 if `JOB_MAX_JOBS` jobs are registered and not finished.
+ */
+int job_register(Job *job, JobFunction job_function, uint8_t priority, void *context);
+
+/**
+ * @brief Notifies a job, waking it up if it is waiting in `JOB_WAIT_NOTIFY`.
+ *
+ * A notification sent while the job was not waiting is kept until its next
+ * `JOB_WAIT_NOTIFY`.
+ *
+ * @param job The job to notify.
+ * @return None
+ *
+ * @note Safe to call from tasks and interrupt handlers.
+ */
+void job_notify(Job *job);
+
+/**
+ * @brief Helper of `JOB_DELAY`, computes the wake tick of the job.
+ *
+ * @param job The job going to sleep.
+ * @param ticks The number of system ticks to sleep.
+ * @return JOB_DELAYED
+ */
+uint8_t job_sleep(Job *job, uint32_t ticks);
+
+/**
+ * @brief Helper of `JOB_WAIT_NOTIFY`, consumes a pending notification.
+ *
+ * @param job The job checking its notification.
+ * @return 1 if a notification was pending, 0 otherwise.
+ */
+uint8_t job_take_notify(Job *job);
+
+/**
+ * @brief Job executor task routine.
+ *
+ * Runs forever in the `JOB_EXECUTOR_TASK` slot. Each iteration dispatches the
+ * runnable job with the highest priority, jobs of equal priority taking turns.
+ * When no job is runnable the executor waits, with `task_notify_wait`, until
+ * the next delayed job is due or a job is notified.
+ *
+ * @param None
+ * @return None
+ */
+void job_executor_routine(void);
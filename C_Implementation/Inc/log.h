@@ -0,0 +1,111 @@
+/**
+ * @file log.h
+ * @brief Deferred binary logging for the Embedded Scheduler Project.
+ *
+ * This file contains the logging macro and the function prototypes of the
+ * deferred logger. `LOG` does not format anything on target : it stores the
+ * address of the format string, a timestamp and the raw 32-bit arguments in
+ * a ring buffer owned by the calling task, which costs a few tens of cycles
+ * instead of a `printf`. The idle task drains the rings to USART2 when no
+ * other task is ready, and `tools/log_decode.py` rebuilds the text from the
+ * format strings stored in `scheduler.elf`.
+ *
+ * Every task writes only to its own ring and the interrupt handlers share
+ * one more ring, so each ring has a single producer and a single consumer
+ * and needs no lock. When a ring is full the record is dropped and counted,
+ * the decoder reports the loss.
+ *
+ * Example :
+ * @code
+ * LOG("adc overrun %u, last sample %d", pipe.overruns, sample);
+ * @endcode
+ *
+ * Arguments are stored as 32-bit words : integers, characters and pointers
+ * are supported, 64-bit and floating point values are not. A `%s` argument
+ * is printed only if it points to a constant string of the ELF file.
+ *
+ * Frame sent on USART2 for every record, words in little endian :
+ *
+ *   0x00 | word count | format address | ring << 8 | argument count | timestamp us | arguments
+ *
+ * Console text never contains 0x00, so the decoder can tell both apart.
+ *
+ * @author Bilel
+ * @date 2024-10-28
+ */
+
+#include <stdint.h>
+
+#define LOG_RING_WORDS        64U         // Size of each ring in 32-bit words, a power of two
+#define LOG_MAX_ARGS          6U          // Most arguments accepted by one LOG call
+#define LOG_HEADER_WORDS      3U          // Format address, ring and argument count, timestamp
+#define LOG_ISR_RING          TOTAL_TASKS // Ring shared by the interrupt handlers
+#define LOG_FRAME_SYNC        0x00U       // First byte of a frame on the console
+
+/*
+ * Each argument is converted on its own, through uintptr_t, so integers and
+ * pointers are stored without -Wint-conversion. LOG_ARGS_ counts the
+ * arguments and picks the LOG_ARGS_<n> that wraps them, more than
+ * LOG_MAX_ARGS arguments do not expand to a valid macro.
+ */
+#define LOG_ARG_(x)                   , (uint32_t)(uintptr_t)(x)
+#define LOG_ARGS_0()
+#define LOG_ARGS_1(a)                 LOG_ARG_(a)
+#define LOG_ARGS_2(a, b)              LOG_ARG_(a) LOG_ARG_(b)
+#define LOG_ARGS_3(a, b, c)           LOG_ARG_(a) LOG_ARG_(b) LOG_ARG_(c)
+#define LOG_ARGS_4(a, b, c, d)        LOG_ARGS_3(a, b, c) LOG_ARG_(d)
+#define LOG_ARGS_5(a, b, c, d, e)     LOG_ARGS_4(a, b, c, d) LOG_ARG_(e)
+#define LOG_ARGS_6(a, b, c, d, e, f)  LOG_ARGS_5(a, b, c, d, e) LOG_ARG_(f)
+#define LOG_COUNT_(_0, _1, _2, _3, _4, _5, _6, count, ...) count
+#define LOG_SELECT_(count)            LOG_ARGS_ ## count
+#define LOG_EXPAND_(count)            LOG_SELECT_(count)
+#define LOG_ARGS_(...)                LOG_EXPAND_(LOG_COUNT_(0, ##__VA_ARGS__, 6, 5, 4, 3, 2, 1, 0))(__VA_ARGS__)
+
+/**
+ * @brief Records a log message with up to `LOG_MAX_ARGS` integer or pointer arguments.
+ *
+ * The format string stays in flash and only its address is recorded. Safe
+ * to call from tasks and from interrupt handlers.
+ */
+#define LOG(fmt, ...) do {                                                          \
+    static const char log_fmt_[] = fmt;                                             \
+    const uint32_t log_args_[] = { 0 LOG_ARGS_(__VA_ARGS__) };                      \
+    _Static_assert(sizeof(log_args_) <= (LOG_MAX_ARGS + 1) * sizeof(uint32_t),      \
+                   "too many LOG arguments");                                       \
+    log_record(log_fmt_, &log_args_[1], sizeof(log_args_) / sizeof(uint32_t) - 1);  \
+  } while (0)
+
+/**
+ * @brief Appends a record to the ring of the caller, used by `LOG`.
+ *
+ * The ring is the one of `c_task`, or `LOG_ISR_RING` in handler mode. The
+ * record is written first and published by a single store of the ring head,
+ * so the drain never sees half a record.
+ *
+ * @param fmt The format string of the message.
+ * @param args The arguments of the message.
+ * @param nargs The number of arguments.
+ * @return None
+ */
+void log_record(const char *fmt, const uint32_t *args, uint32_t nargs);
+
+/**
+ * @brief Sends the pending records of every ring to USART2.
+ *
+ * Called from the idle task. A record is only sent when the UART transmit
+ * ring can take its whole frame, otherwise it stays in its ring until the
+ * next call. Records dropped by a full ring are reported by a frame with a
+ * null format address and the number of lost records as argument.
+ *
+ * @param None
+ * @return None
+ */
+void log_drain(void);
+
+/**
+ * @brief Returns the number of records dropped because a ring was full.
+ *
+ * @param ring The index of a task, or `LOG_ISR_RING`.
+ * @return The number of dropped records since boot.
+ */
+uint32_t log_dropped(uint8_t ring);
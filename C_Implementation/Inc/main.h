@@ -19,9 +19,33 @@
 #define TASK3_STACK_START       (TASK2_STACK_START - TASK_STACK_SIZE) // Task 3 stack start address
 #define TASK4_STACK_START       (TASK3_STACK_START - TASK_STACK_SIZE) // Task 4 stack start address
 #define IDLE_STACK_START        (TASK4_STACK_START - TASK_STACK_SIZE) // Task 4 stack start address
-#define SCHEDULER_STACK_START   (IDLE_STACK_START - SCHEDULER_STACK_SIZE) // Scheduler stack start address
+#define JOB_EXECUTOR_STACK_START (IDLE_STACK_START - TASK_STACK_SIZE) // Job executor stack start address, shared by all jobs
+#define SHELL_STACK_START       (JOB_EXECUTOR_STACK_START - TASK_STACK_SIZE) // Shell stack start address
+#define SCHEDULER_STACK_START   (SHELL_STACK_START - SCHEDULER_STACK_SIZE) // Scheduler stack start address
+#define STACK_FILL_PATTERN      0xA5A5A5A5U // Unused stack words, scanned for the stack high-water mark
 
-#define TOTAL_TASKS             5           // Total number of tasks
+// Large buffers that are fully written before use are kept out of .bss so
+// Reset_Handler does not spend boot time clearing them. The section is NOBITS
+// ("@" comments out the flags appended by the compiler), so it is neither
+// loaded nor zeroed. Task stacks are already outside .bss, at the fixed
+// addresses above.
+//
+// Without a rule the linker places .noinit as an orphan section, wherever it
+// sees fit. STM32F407VGTX_FLASH.ld must place it in RAM, right after .bss :
+//
+//   .noinit (NOLOAD) :
+//   {
+//     . = ALIGN(8);
+//     *(.noinit .noinit.*)
+//     . = ALIGN(8);
+//   } >RAM
+#define NOINIT                  __attribute__((section(".noinit,\"aw\",%nobits@")))
+
+#define TOTAL_TASKS             9           // Total number of task slots
+#define STATIC_TASKS            7           // Tasks started at boot, the other slots are for task_create
+#define TASK_DEFAULT_PRIORITY   2U          // Priority of the tasks started by task_create
+#define JOB_EXECUTOR_TASK       5           // Task index of the job executor
+#define SHELL_TASK              6           // Task index of the statistics shell
 #define SYSTEM_TICK_RATE_HZ     1U          // System tick rate in Hz (1ms tick)
 #define HSI_CLOCK_FREQUENCY_HZ  16000000U    // HSI clock frequency in Hz
 
@@ -30,6 +54,30 @@
 
 #define RUNNING        0x1
 #define BLOCKED        0x0
+#define WAITING        0x2  // Blocked until notified, or until remaining_ticks if wait_timed is set
+#define SUSPENDED      0x3  // Out of the ready set until task_resume
+#define EXITED         0x4  // Finished, or a free slot for task_create when stack_top is 0
+
+// Scheduling policies, select one at build time with -DSCHED_POLICY=<policy>
+#define SCHED_POLICY_RR         0           // Strict round robin over all ready tasks
+#define SCHED_POLICY_MLFQ       1           // Multi-level feedback queue
+#define SCHED_POLICY_PRIORITY   2           // Fixed priorities, round robin among equal priorities
+
+#ifndef SCHED_POLICY
+#define SCHED_POLICY            SCHED_POLICY_RR
+#endif
+
+#define MLFQ_LEVELS             3U          // Number of MLFQ priority levels, 0 is the highest
+#define MLFQ_BASE_SLICE_TICKS   1U          // Time slice of level 0, doubled at every lower level
+#define MLFQ_BOOST_PERIOD_TICKS 20U         // Every task is moved back to level 0 at this period
+
+// Unprivileged tasks with their own MPU regions, see mpu.h. Build with
+// -DMPU_ISOLATION=0 to run every task privileged without the MPU.
+#ifndef MPU_ISOLATION
+#define MPU_ISOLATION           1
+#endif
+
+#define TASK_MPU_REGIONS        3U          // MPU regions of a task besides its stack
 
 
 
@@ -131,6 +179,12 @@ void set_psp_value(uint32_t task_psp);
 /**
  * @brief Updates the current task to the next runnable task.
  *
+ * The time elapsed since the previous switch is first added to the
+ * `run_time_us` and `activation_us` of the outgoing task. When the outgoing
+ * task has blocked, its activation is over and `wcet_us` keeps the longest
+ * one. The cycles spent in the function are tracked in `g_switch_cycles_max`.
+ * `task_on_switch_out` then finishes an exit or a restart of the outgoing task.
+ *
  * This function increments the current task index (`c_task`) to point to the 
  * next task in a circular manner, skipping any tasks that are in a blocked state. 
  * If no tasks are in a runnable state, it defaults to the idle task (index 0).
@@ -142,6 +196,12 @@ void set_psp_value(uint32_t task_psp);
  *   the next runnable task. Otherwise, it falls back to the idle task.
  *
  * @note The idle task (task index 0) is chosen only when no other tasks are runnable.
+ * @note When built with `SCHED_POLICY == SCHED_POLICY_MLFQ`, the choice is
+ *       delegated to `mlfq_select_next`. With `SCHED_POLICY_PRIORITY`, the
+ *       highest priority ready task is chosen.
+ * @note Whatever the policy, a task that raised its preemption threshold
+ *       with `task_set_threshold` keeps the CPU until it blocks, unless a
+ *       ready task has a priority above the threshold.
  * 
  * @param None
  * @return None
@@ -172,13 +232,35 @@ void increment_tick(void);
  */
 void trig_pendsv(void);
 
+/**
+ * @brief Enters a critical section by masking all configurable interrupts.
+ *
+ * This function saves the current value of PRIMASK and then sets it, so
+ * neither interrupt handlers nor a context switch can run until the matching
+ * `exit_critical` call. Critical sections may be nested, each level restores
+ * the state it found.
+ *
+ * @param None
+ * @return The previous PRIMASK value, to be passed to `exit_critical`.
+ */
+uint32_t enter_critical(void);
+
+/**
+ * @brief Leaves a critical section entered with `enter_critical`.
+ *
+ * @param primask The value returned by the matching `enter_critical` call.
+ * @return None
+ */
+void exit_critical(uint32_t primask);
+
 /**
  * @brief Checks the state of all tasks and updates blocked tasks.
  *
  * This function iterates through all tasks and checks if they are 
- * in the BLOCKED state. If a task's remaining_ticks matches the 
- * current tick count (g_tick_count), the task's state is updated 
- * to RUNNING, indicating that it is ready to execute again.
+ * in the BLOCKED state, or in the WAITING state with a timeout. If a 
+ * task's remaining_ticks matches the current tick count (g_tick_count), 
+ * the task's state is updated to RUNNING, indicating that it is ready 
+ * to execute again.
  *
  * This function is typically called during the task scheduling 
  * process to determine which blocked tasks can be unblocked.
@@ -202,6 +284,20 @@ typedef struct
     uint32_t remaining_ticks;         
     uint8_t task_state;           
     void (*task_function)(void); 
+    uint8_t mlfq_level;          // MLFQ level, 0 is the highest (SCHED_POLICY_MLFQ only)
+    uint8_t slice_left;          // Ticks left in the current MLFQ time slice
+    uint8_t notify_pending;      // Set by task_notify, consumed by task_notify_wait
+    uint8_t wait_timed;          // The WAITING state ends at remaining_ticks as well
+    uint32_t run_time_us;        // CPU time used by the task, wraps around
+    uint32_t activation_us;      // CPU time used since the task last blocked
+    uint32_t wcet_us;            // Longest activation observed, from release to blocking
+    uint32_t stack_top;          // Highest address of the task stack, 0 for a free slot
+    uint8_t restart_pending;     // Restart requested by the task itself, done at switch out
+    uint8_t priority;            // Fixed priority, higher runs first, 0 is the idle task
+    uint8_t preempt_threshold;   // Only tasks with a priority above it may preempt the task
+    uint8_t unprivileged;        // Runs with CONTROL.nPRIV set, scheduler calls go through SVC
+    uint32_t mpu_rbar[TASK_MPU_REGIONS]; // Extra MPU regions loaded when the task is switched in
+    uint32_t mpu_rasr[TASK_MPU_REGIONS]; // Attributes and size of the regions, 0 when unused
 } TaskControlBlock;
 
 
@@ -0,0 +1,147 @@
+/**
+ * @file mempool.h
+ * @brief Fixed-block memory pools for the Embedded Scheduler Project.
+ *
+ * This file defines the MemPool structure, the size classes of the kernel
+ * memory pools and the function prototypes of the allocator. Every size class
+ * is a pool of equally sized blocks linked in a free list, so allocation and
+ * release are O(1), never fragment and may be called from interrupt handlers.
+ *
+ * The stacks of the tasks started by `task_create` come from one more pool,
+ * reserved to them : `mem_alloc` and `malloc` cannot take its blocks.
+ *
+ * @author Bilel
+ * @date 2024-10-28
+ */
+
+#include <stdint.h>
+
+#define MEMPOOL_CLASSES         6           // Number of block size classes
+
+// Block size (bytes, multiple of 8) and block count of each size class, smallest first
+#define MEMPOOL_CLASS0_SIZE     16U
+#define MEMPOOL_CLASS0_COUNT    32U
+#define MEMPOOL_CLASS1_SIZE     32U
+#define MEMPOOL_CLASS1_COUNT    32U
+#define MEMPOOL_CLASS2_SIZE     64U
+#define MEMPOOL_CLASS2_COUNT    16U
+#define MEMPOOL_CLASS3_SIZE     128U
+#define MEMPOOL_CLASS3_COUNT    8U
+#define MEMPOOL_CLASS4_SIZE     256U
+#define MEMPOOL_CLASS4_COUNT    4U
+#define MEMPOOL_CLASS5_SIZE     1024U
+#define MEMPOOL_CLASS5_COUNT    2U
+
+// Task stack pool, used by mem_stack_alloc only
+#define MEMPOOL_STACK_SIZE      1024U       // TASK_STACK_SIZE
+#define MEMPOOL_STACK_COUNT     2U          // One per dynamic task slot
+#define MEMPOOL_STACK_POOL      0xFFU       // Index of the stack pool for mempool_stats
+
+/**
+ * @brief Represents one size class of the kernel memory pools.
+ *
+ * The free blocks are chained through their first word. Besides the
+ * bookkeeping needed by the allocator, the structure keeps the usage
+ * statistics of the pool.
+ */
+typedef struct
+{
+    uint32_t block_size;         // Size of every block in bytes
+    uint32_t block_count;        // Number of blocks in the pool
+    uint8_t *storage;            // First block of the pool
+    void *free_list;             // Next free block, NULL when the pool is exhausted
+    uint32_t used;               // Blocks currently allocated
+    uint32_t peak_used;          // High-water mark of `used`
+    uint32_t largest_request;    // Largest request served by this pool, in bytes
+    uint32_t failures;           // Requests that could not be served by this class or any larger one
+} MemPool;
+
+/**
+ * @brief Initializes all the memory pools.
+ *
+ * This function links every block of every size class into the free list of
+ * its pool and clears the usage statistics.
+ *
+ * @note This function must be called before any allocation, including the
+ *       ones done by the C library through `malloc`.
+ *
+ * @param None
+ * @return None
+ */
+void mempool_init(void);
+
+/**
+ * @brief Allocates a block of at least `size` bytes.
+ *
+ * The smallest size class able to hold `size` bytes is used. When that pool
+ * is exhausted the next larger class is tried, so the cost is bounded by
+ * `MEMPOOL_CLASSES` and does not depend on the allocation history.
+ *
+ * @param size The number of bytes requested.
+ * @return A pointer to an 8-byte aligned block, or NULL if no pool can serve
+ *         the request. The failure is accounted to the smallest fitting class,
+ *         or to `mempool_oversize_failures` when no class is large enough.
+ *
+ * @note Safe to call from tasks and interrupt handlers.
+ */
+void *mem_alloc(uint32_t size);
+
+/**
+ * @brief Returns a block to the pool it was allocated from.
+ *
+ * The owning pool is found from the block address. NULL and pointers that do
+ * not belong to any pool are ignored. A pointer inside a block but not at its
+ * start, or a free while the pool has no block allocated, stops the system
+ * in a loop : the free list would be corrupted otherwise.
+ *
+ * @param block The block to release.
+ * @return None
+ *
+ * @note Safe to call from tasks and interrupt handlers.
+ */
+void mem_free(void *block);
+
+/**
+ * @brief Allocates a task stack from the stack pool.
+ *
+ * @param None
+ * @return The lowest address of a `MEMPOOL_STACK_SIZE` block, or NULL if every stack is in use.
+ *
+ * @note Safe to call from tasks and interrupt handlers.
+ */
+void *mem_stack_alloc(void);
+
+/**
+ * @brief Returns a stack allocated by `mem_stack_alloc` to the stack pool.
+ *
+ * Pointers outside the stack pool are ignored.
+ *
+ * @param stack The lowest address of the stack.
+ * @return None
+ */
+void mem_stack_free(void *stack);
+
+/**
+ * @brief Returns the size of the block holding `block`.
+ *
+ * @param block A block returned by `mem_alloc`.
+ * @return The usable size of the block in bytes, 0 if it belongs to no pool.
+ */
+uint32_t mem_block_size(void *block);
+
+/**
+ * @brief Gives access to the statistics of a size class.
+ *
+ * @param pool_class Index of the size class, from 0 to `MEMPOOL_CLASSES - 1`,
+ *                   or `MEMPOOL_STACK_POOL`.
+ * @return A pointer to the pool descriptor, or NULL for an invalid index.
+ */
+const MemPool *mempool_stats(uint8_t pool_class);
+
+/**
+ * @brief Returns the number of requests larger than the largest size class.
+ *
+ * @param None
+ * @return The number of oversize requests since `mempool_init`.
+ */
+uint32_t mempool_oversize_failures(void);
@@ -0,0 +1,67 @@
+/**
+ * @file mlfq.h
+ * @brief Multi-level feedback queue scheduling policy.
+ *
+ * This file contains the function prototypes of the MLFQ policy, enabled by
+ * building with `SCHED_POLICY == SCHED_POLICY_MLFQ`. Tasks start at level 0
+ * and move between `MLFQ_LEVELS` levels depending on how they use the CPU:
+ *
+ * - A task that consumes its whole time slice is demoted one level.
+ * - A task that blocks before its slice is over is promoted one level.
+ * - Every `MLFQ_BOOST_PERIOD_TICKS` all tasks go back to level 0, so demoted
+ *   CPU-bound tasks cannot starve.
+ *
+ * The highest non-empty level always runs first, tasks of the same level
+ * share the CPU in round robin. The time slice of level `n` is
+ * `MLFQ_BASE_SLICE_TICKS << n` ticks.
+ *
+ * @author Bilel
+ * @date 2024-10-28
+ */
+
+#include <stdint.h>
+
+/**
+ * @brief Places every task at level 0 with a full time slice.
+ *
+ * @note This function must be called after `init_tasks_stack`.
+ *
+ * @param None
+ * @return None
+ */
+void mlfq_init(void);
+
+/**
+ * @brief Accounts one tick to the running task and applies the periodic boost.
+ *
+ * Called from the SysTick handler. When the running task reaches the end of
+ * its time slice it is demoted one level.
+ *
+ * @param None
+ * @return None
+ */
+void mlfq_on_tick(void);
+
+/**
+ * @brief Promotes the running task if it blocks before the end of its slice.
+ *
+ * Called by `task_delay` before the current task is blocked.
+ *
+ * @param None
+ * @return None
+ */
+void mlfq_on_block(void);
+
+/**
+ * @brief Selects the next task to run according to the MLFQ policy.
+ *
+ * The current task keeps the CPU while it is runnable, has time left in its
+ * slice and no task of a higher level is runnable. Otherwise `c_task` is set
+ * to the next runnable task of the highest non-empty level, in round robin
+ * order, and that task receives a full time slice. The idle task is chosen
+ * when no other task is runnable.
+ *
+ * @param None
+ * @return None
+ */
+void mlfq_select_next(void);
@@ -0,0 +1,122 @@
+/**
+ * @file mpu.h
+ * @brief Memory protection of the unprivileged tasks.
+ *
+ * This file contains the MPU register definitions and the function
+ * prototypes of the task isolation. When built with `MPU_ISOLATION` (see
+ * main.h), the tasks marked unprivileged run with CONTROL.nPRIV set and may
+ * only access :
+ *
+ * | Region | Content                          | Unprivileged access     |
+ * |--------|----------------------------------|-------------------------|
+ * | 0      | flash, code and constants        | read, execute           |
+ * | 4      | the stack of the running task    | read, write             |
+ * | 5      | the data block of the task       | read, write             |
+ * | 6, 7   | `mpu_task_region` of the task    | as given by the task    |
+ *
+ * Everything else faults, and `MemManage_Handler` ends the offending task
+ * instead of stopping the system. Privileged code keeps the default memory
+ * map (PRIVDEFENA). Regions 4 to 7 are reloaded by `mpu_switch` when an
+ * unprivileged task is switched in.
+ *
+ * Ordinary globals and statics are out of reach of an unprivileged task.
+ * Its state lives in one data block, a structure declared `MPU_TASK_DATA`
+ * and given to the task with `mpu_task_data` :
+ *
+ * @code
+ * typedef struct MPU_TASK_DATA { uint32_t toggles; } LedTaskData;
+ * static LedTaskData task3_data;
+ * mpu_task_data(3, &task3_data);
+ * @endcode
+ *
+ * The attribute aligns the type on the region size and pads it to that
+ * size, so no other variable shares the region.
+ *
+ * Unprivileged tasks reach the scheduler through the SVC gate of svc.h.
+ * They cannot use `LOG`, `delay_us` or the peripherals they were not given
+ * a region for. The first task (task 1) is started by `main` and stays
+ * privileged.
+ *
+ * @author Bilel
+ * @date 2024-10-28
+ */
+
+#include <stdint.h>
+
+#define MPU_TYPE      (*(volatile uint32_t *)0xE000ED90) // MPU type register
+#define MPU_CTRL      (*(volatile uint32_t *)0xE000ED94) // MPU control register
+#define MPU_RNR       (*(volatile uint32_t *)0xE000ED98) // MPU region number register
+#define MPU_RBAR      (*(volatile uint32_t *)0xE000ED9C) // MPU region base address register
+#define MPU_RASR      (*(volatile uint32_t *)0xE000EDA0) // MPU region attribute and size register
+
+#define MPU_CTRL_ENABLE       (1U << 0)
+#define MPU_CTRL_PRIVDEFENA   (1U << 2)   // Default memory map for privileged accesses
+#define MPU_RBAR_VALID        (1U << 4)   // The region number comes from RBAR
+
+// Region attributes, for mpu_task_region
+#define MPU_RASR_ENABLE       (1U << 0)
+#define MPU_SIZE(log2)        (((uint32_t)(log2) - 1U) << 1) // Region of 2^log2 bytes, at least 32
+#define MPU_AP_FULL           (3U << 24)  // Read and write, privileged or not
+#define MPU_AP_USER_RO        (2U << 24)  // Privileged read and write, unprivileged read only
+#define MPU_XN                (1U << 28)  // No instruction fetch
+#define MPU_NORMAL            (1U << 17)  // Normal memory, cacheable (S = 0, C = 1, B = 0)
+#define MPU_DEVICE            (1U << 16)  // Shared device memory, for peripherals (B = 1)
+
+#define MPU_FLASH_REGION      0U
+#define MPU_STACK_REGION      4U
+#define MPU_TASK_REGION       5U          // First of the TASK_MPU_REGIONS regions of a task
+#define MPU_DATA_SLOT         0U          // Region of the task used for its data block
+#define MPU_STACK_SIZE_LOG2   10U         // log2(TASK_STACK_SIZE), stacks are aligned on their size
+
+#define MPU_TASK_DATA_LOG2    8U          // Data block of an unprivileged task : 256 bytes
+#define MPU_TASK_DATA         __attribute__((aligned(1U << MPU_TASK_DATA_LOG2))) // For the type of a data block
+
+/**
+ * @brief Maps the flash for the unprivileged tasks and enables the MPU.
+ *
+ * Called by `main` once the tasks are built, before the first switch.
+ *
+ * @param None
+ * @return None
+ */
+void mpu_init(void);
+
+/**
+ * @brief Gives a task access to a memory range while it runs.
+ *
+ * The range must be aligned on its size. Call it before the task first runs.
+ *
+ * @code
+ * mpu_task_region(3, 1, GPIOD_BASE, 10, MPU_AP_FULL | MPU_XN | MPU_DEVICE);
+ * @endcode
+ *
+ * @param task The index of the task.
+ * @param region The region of the task, below `TASK_MPU_REGIONS`. Region
+ *               `MPU_DATA_SLOT` is the one of `mpu_task_data`.
+ * @param base The lowest address of the range.
+ * @param size_log2 The size of the range as a power of two, 5 to 32.
+ * @param attributes `MPU_AP_*` access, `MPU_XN` and the memory type.
+ * @return None
+ */
+void mpu_task_region(uint8_t task, uint8_t region, uint32_t base, uint32_t size_log2, uint32_t attributes);
+
+/**
+ * @brief Gives a task read and write access to its data block.
+ *
+ * @param task The index of the task.
+ * @param data An object whose type is declared `MPU_TASK_DATA`.
+ * @return None
+ */
+void mpu_task_data(uint8_t task, void *data);
+
+/**
+ * @brief Applies the privilege and the regions of the task being switched in.
+ *
+ * Called by `update_next_task` from PendSV. Privileged tasks only clear
+ * CONTROL.nPRIV : the regions of the previous task do not restrict them.
+ * The exception return that follows synchronizes the new settings.
+ *
+ * @param task The index of the incoming task.
+ * @return None
+ */
+void mpu_switch(uint8_t task);
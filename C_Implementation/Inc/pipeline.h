@@ -0,0 +1,149 @@
+/**
+ * @file pipeline.h
+ * @brief Zero-copy DMA buffer pipeline from peripherals to tasks.
+ *
+ * This file defines the Pipe structure and the function prototypes of the
+ * buffer pipeline. A pipe owns a pool of equally sized buffers. The DMA
+ * stream runs in double-buffer mode : it fills the buffer of one memory
+ * target while the other target's buffer is complete. On every transfer
+ * complete interrupt the pipe :
+ *
+ * 1. hands the completed buffer, by pointer, to the consumer task,
+ * 2. programs a free buffer of the pool in the completed memory target,
+ * 3. notifies the consumer task.
+ *
+ * The consumer processes the buffer in place and gives it back to the pool
+ * with `pipe_release`, so samples are never copied. When the consumer falls
+ * behind and the pool is empty, the completed buffer stays with the DMA and
+ * its samples are overwritten, which is counted as an overrun.
+ *
+ * Example, ADC1 on DMA2 Stream 0 channel 0 :
+ * @code
+ * static uint16_t adc_storage[4][256];
+ * static Pipe adc_pipe;
+ *
+ * pipe_init(&adc_pipe, adc_storage, sizeof(adc_storage[0]), 4, 1);   // consumed by task 1
+ * pipe_dma_start(&adc_pipe, DMA_STREAM_BASE(DMA2_BASE, 0), 0,
+ *                ADC1_DR_ADDRESS, 256, PIPE_DATA_HALFWORD);
+ *
+ * void DMA2_Stream0_IRQHandler(void) {
+ *   DMA2_LIFCR = (1 << 5);                       // clear TCIF0
+ *   pipe_dma_isr(&adc_pipe);
+ * }
+ *
+ * // consumer task
+ * uint16_t *samples = pipe_acquire(&adc_pipe, 0);
+ * process(samples);
+ * pipe_release(&adc_pipe, samples);
+ * @endcode
+ *
+ * @author Bilel
+ * @date 2024-10-28
+ */
+
+#include <stdint.h>
+
+#define PIPE_MAX_BUFFERS      8U          // Maximum number of buffers of a pipe
+
+#define DMA2_BASE             0x40026400  // Base address for DMA2 (DMA1_BASE is in uart.h)
+
+// DMA stream registers, `stream_base` is given by DMA_STREAM_BASE
+#define DMA_STREAM_BASE(dma_base, stream)  ((dma_base) + 0x10 + 0x18 * (stream))
+#define DMA_SxCR(stream_base)    (*(volatile uint32_t *)((stream_base) + 0x00)) // Stream configuration register
+#define DMA_SxNDTR(stream_base)  (*(volatile uint32_t *)((stream_base) + 0x04)) // Stream number of data register
+#define DMA_SxPAR(stream_base)   (*(volatile uint32_t *)((stream_base) + 0x08)) // Stream peripheral address register
+#define DMA_SxM0AR(stream_base)  (*(volatile uint32_t *)((stream_base) + 0x0C)) // Stream memory 0 address register
+#define DMA_SxM1AR(stream_base)  (*(volatile uint32_t *)((stream_base) + 0x10)) // Stream memory 1 address register
+
+// Size of one DMA transfer, used for both the peripheral and the memory side
+#define PIPE_DATA_BYTE        0U
+#define PIPE_DATA_HALFWORD    1U
+#define PIPE_DATA_WORD        2U
+
+/**
+ * @brief Represents a buffer pipeline between a DMA stream and a consumer task.
+ *
+ * Every buffer is always owned by exactly one of : the free pool, one of the
+ * two DMA memory targets, the queue of filled buffers, or the consumer task.
+ */
+typedef struct
+{
+    void *free_buffers[PIPE_MAX_BUFFERS];   // Pool of buffers available to the DMA
+    uint8_t free_count;
+    void *filled[PIPE_MAX_BUFFERS];         // Filled buffers waiting for the consumer, oldest first
+    uint8_t filled_head;
+    uint8_t filled_count;
+    void *dma_target[2];                    // Buffers owned by DMA memory target 0 and 1
+    uint32_t stream_base;                   // DMA stream feeding the pipe
+    uint8_t consumer_task;                  // Task notified when a buffer is filled
+    uint32_t delivered;                     // Buffers handed to the consumer
+    uint32_t overruns;                      // Buffers overwritten because the pool was empty
+} Pipe;
+
+/**
+ * @brief Initializes a pipe and puts all its buffers in the free pool.
+ *
+ * @param pipe The pipe to initialize.
+ * @param storage Contiguous storage of `buffer_count` buffers of `buffer_size` bytes,
+ *        aligned on the DMA transfer size.
+ * @param buffer_size The size of one buffer in bytes.
+ * @param buffer_count The number of buffers, from 3 to `PIPE_MAX_BUFFERS` : two are
+ *        always owned by the DMA.
+ * @param consumer_task The index of the task consuming the buffers.
+ *
+ * @return 0 on success, -1 if `buffer_count` is out of range.
+ */
+int pipe_init(Pipe *pipe, void *storage, uint32_t buffer_size, uint8_t buffer_count, uint8_t consumer_task);
+
+/**
+ * @brief Configures and starts a DMA stream in double-buffer mode for the pipe.
+ *
+ * Two buffers are taken from the pool for the memory targets. The stream is
+ * configured peripheral to memory, circular, with memory increment and the
+ * transfer complete interrupt. The caller enables the stream interrupt in
+ * the NVIC and calls `pipe_dma_isr` from its handler.
+ *
+ * @param pipe The pipe fed by the stream.
+ * @param stream_base The stream register base, see `DMA_STREAM_BASE`.
+ * @param channel The DMA request channel of the peripheral (0 to 7).
+ * @param peripheral_address The address of the peripheral data register.
+ * @param transfers The number of transfers filling one buffer.
+ * @param data_size One of PIPE_DATA_BYTE, PIPE_DATA_HALFWORD, PIPE_DATA_WORD.
+ *
+ * @return None
+ */
+void pipe_dma_start(Pipe *pipe, uint32_t stream_base, uint8_t channel,
+                    uint32_t peripheral_address, uint32_t transfers, uint8_t data_size);
+
+/**
+ * @brief Passes the buffer just completed by the DMA to the consumer task.
+ *
+ * To be called from the transfer complete interrupt of the stream, after the
+ * interrupt flag is cleared. The completed memory target is the one the
+ * stream is no longer using (SxCR.CT), it is reloaded with a free buffer.
+ *
+ * @param pipe The pipe fed by the stream.
+ * @return None
+ */
+void pipe_dma_isr(Pipe *pipe);
+
+/**
+ * @brief Takes ownership of the oldest filled buffer, waiting for one if needed.
+ *
+ * @param pipe The pipe to read from.
+ * @param timeout_tick The maximum number of system ticks to wait, 0 to wait forever.
+ *
+ * @return The filled buffer, or NULL if the timeout expired.
+ *
+ * @note Only the consumer task of the pipe may call this function.
+ */
+void *pipe_acquire(Pipe *pipe, uint32_t timeout_tick);
+
+/**
+ * @brief Gives a buffer obtained with `pipe_acquire` back to the pool.
+ *
+ * @param pipe The pipe the buffer belongs to.
+ * @param buffer The buffer to release.
+ * @return None
+ */
+void pipe_release(Pipe *pipe, void *buffer);
@@ -0,0 +1,85 @@
+/**
+ * @file profiler.h
+ * @brief Statistical PC-sampling profiler for the Embedded Scheduler Project.
+ *
+ * This file contains the TIM7 register definitions and the function
+ * prototypes of the sampling profiler. TIM7 interrupts the CPU
+ * `PROFILER_SAMPLE_HZ` times per second. Each interrupt records the program
+ * counter and the link register stacked by the interrupted code, along with
+ * `c_task`, in a ring buffer. The idle task sends the samples to USART2, and
+ * `tools/profile.py` symbolizes them against `scheduler.elf` into per-task
+ * flat profiles and folded stacks for flame graphs.
+ *
+ * Build with `-DPROFILER_ENABLE=1`. The DWT PC sampler is not used, because
+ * its output needs an SWO trace probe. TIM7 only needs the console.
+ *
+ * Frame sent on USART2 for a batch of samples, words in little endian :
+ *
+ *   0x01 | sample count | (pc, lr, task) per sample
+ *
+ * The rate is limited by the console : at 115200 baud about 900 samples per
+ * second fit, samples that cannot be sent in time are counted as lost.
+ *
+ * @author Bilel
+ * @date 2024-10-28
+ */
+
+#include <stdint.h>
+
+#define TIM7_BASE     0x40001400  // Base address for TIM7 (basic timer)
+
+// Define offset for registers
+#define TIM7_CR1      (*(volatile uint32_t *)(TIM7_BASE + 0x00)) // TIM7 control register 1
+#define TIM7_DIER     (*(volatile uint32_t *)(TIM7_BASE + 0x0C)) // TIM7 DMA/interrupt enable register
+#define TIM7_SR       (*(volatile uint32_t *)(TIM7_BASE + 0x10)) // TIM7 status register
+#define TIM7_PSC      (*(volatile uint32_t *)(TIM7_BASE + 0x28)) // TIM7 prescaler
+#define TIM7_ARR      (*(volatile uint32_t *)(TIM7_BASE + 0x2C)) // TIM7 auto-reload register
+
+#define TIM7_IRQ              55U         // TIM7 interrupt number
+
+#ifndef PROFILER_ENABLE
+#define PROFILER_ENABLE       0
+#endif
+
+#define PROFILER_SAMPLE_HZ    499U        // Sampling rate, prime so it does not beat with periodic tasks
+#define PROFILER_RING_SAMPLES 128U        // Samples buffered between two drains, a power of two
+#define PROFILER_FRAME_SAMPLES 8U         // Most samples sent in one frame
+#define PROFILER_FRAME_SYNC   0x01U       // First byte of a sample frame on the console
+
+/**
+ * @brief Starts TIM7 and the sampling interrupt.
+ *
+ * Called from `boot_post_start` when `PROFILER_ENABLE` is set.
+ *
+ * @param None
+ * @return None
+ */
+void profiler_init(void);
+
+/**
+ * @brief Records one sample, called by the TIM7 interrupt handler.
+ *
+ * @param frame The exception frame stacked by the interrupted code :
+ *        R0-R3, R12, LR, PC, xPSR.
+ * @return None
+ */
+void profiler_sample(uint32_t *frame);
+
+/**
+ * @brief Sends the buffered samples to USART2.
+ *
+ * Called from the idle task. Like `log_drain`, a frame is only queued when
+ * the UART transmit ring can take all of it.
+ *
+ * @param None
+ * @return None
+ */
+void profiler_drain(void);
+
+/**
+ * @brief Returns the number of samples lost because the ring was full.
+ *
+ * @param None
+ * @return The number of lost samples since `profiler_init`.
+ */
+uint32_t profiler_lost_samples(void);
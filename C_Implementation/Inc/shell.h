@@ -0,0 +1,38 @@
+/**
+ * @file shell.h
+ * @brief Runtime statistics shell of the Embedded Scheduler Project.
+ *
+ * This file contains the function prototypes of the shell task. The shell
+ * reads commands from USART2 and prints a `top`-style table of the tasks :
+ * state, CPU share since the previous refresh, stack high-water mark and
+ * longest activation, along with the tick count, the worst tick and context
+ * switch overheads and the memory pool usage. A capture of this output feeds
+ * `tools/schedulability.py`.
+ *
+ * Commands (terminated by Enter) :
+ * - `top`  : print the table every `SHELL_REFRESH_TICKS` ticks
+ * - `stop` : stop the periodic refresh
+ * - `boot` : print the boot phase timestamps recorded by boot.h and the cost of the SVC gate
+ * - `help` : list the commands
+ *
+ * @author Bilel
+ * @date 2024-10-28
+ */
+
+#include <stdint.h>
+
+#define SHELL_REFRESH_TICKS   1U          // Period of the top view in system ticks
+#define SHELL_LINE_SIZE       32U         // Longest command line accepted
+
+/**
+ * @brief Shell task routine.
+ *
+ * Waits for received bytes or the next refresh with `task_notify_wait`,
+ * executes the commands typed on the console and prints the top view while
+ * it is enabled. Every output goes through `uart_write`, so the shell never
+ * waits for the line.
+ *
+ * @param None
+ * @return None
+ */
+void shell_routine(void);
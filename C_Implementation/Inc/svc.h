@@ -0,0 +1,93 @@
+/**
+ * @file svc.h
+ * @brief SVC call gate of the Embedded Scheduler Project.
+ *
+ * This file contains the service numbers and the helpers of the supervisor
+ * call gate. Tasks running unprivileged (see mpu.h) cannot touch the
+ * scheduler data, so the scheduler services they use enter the kernel with
+ * an `SVC #n` instruction. `SVC_Handler` reads `n` from the instruction,
+ * looks the service up in a table and tail-calls it with the exception frame :
+ * the arguments are the stacked R0-R3 and the result is written to the
+ * stacked R0.
+ *
+ * Services validate every argument before acting on it : `SVC_TASK_NOTIFY`
+ * ignores an index that does not name a live task.
+ *
+ * The public functions (`task_delay`, `task_notify_wait`, ...) check the
+ * caller themselves : privileged tasks and interrupt handlers call the
+ * implementation directly, only unprivileged tasks pay for the gate.
+ * `task_create`, `task_suspend`, `task_resume` and `task_restart` have no
+ * service and remain for privileged tasks.
+ *
+ * The round trip of an empty service is measured at boot, see the shell
+ * `boot` command.
+ *
+ * @author Bilel
+ * @date 2024-10-28
+ */
+
+#include <stdint.h>
+
+// Service numbers, index of svc_table
+#define SVC_NOP                 0U          // Empty service, measures the gate
+#define SVC_TASK_DELAY          1U          // task_delay(ticks)
+#define SVC_TASK_WAIT           2U          // task_wait_begin(timeout), first half of task_notify_wait
+#define SVC_TASK_TAKE_NOTIFY    3U          // task_take_notify(), second half of task_notify_wait
+#define SVC_TASK_NOTIFY         4U          // task_notify(task)
+#define SVC_TASK_EXIT           5U          // task_exit()
+#define SVC_TASK_SET_THRESHOLD  6U          // task_set_threshold(threshold)
+#define SVC_COUNT               7           // No suffix, compared in the assembly of SVC_Handler
+
+#define SVC_BUDGET_CYCLES       48U         // Target round trip of SVC_NOP, the cost of the gate itself
+
+/**
+ * @brief Calls service `number` with one argument and returns the stacked R0.
+ *
+ * `number` must be a constant, it is encoded in the SVC instruction.
+ */
+#define SVC_CALL(number, arg) ({                                            \
+    register uint32_t svc_r0_ __asm("r0") = (uint32_t)(arg);                \
+    __asm volatile ("SVC %[id]" : "+r" (svc_r0_) : [id] "i" (number) : "memory"); \
+    svc_r0_;                                                                \
+  })
+
+/**
+ * @brief Tells whether the caller must go through the SVC gate.
+ *
+ * @return Non zero for an unprivileged task : thread mode (IPSR zero) with CONTROL.nPRIV set.
+ */
+static inline uint32_t svc_caller_unprivileged(void) {
+  uint32_t ipsr, control;
+
+  __asm volatile ("MRS %0, IPSR" : "=r" (ipsr));
+  __asm volatile ("MRS %0, CONTROL" : "=r" (control));
+  return (ipsr == 0) && (control & 0x1);
+}
+
+/**
+ * @brief Measures the round trip of the gate with `SVC_NOP`, in CPU cycles.
+ *
+ * Must be called from a task. The cost of reading the cycle counter is
+ * subtracted and the shortest of a few runs is kept, so an interrupt
+ * arriving during a run does not count. `boot_post_start` stores the
+ * result in `g_svc_cycles`.
+ *
+ * @param None
+ * @return The cycles from the SVC instruction back to the caller.
+ */
+uint32_t svc_measure_cycles(void);
+
+/**
+ * @brief Measures a real service called by the current task, in CPU cycles per call.
+ *
+ * Times batches of `task_set_threshold` calls that leave the threshold
+ * unchanged, so from an unprivileged task the whole path is measured : the
+ * caller check, the SVC, the table dispatch, the service and the return.
+ * The DWT is out of reach without privilege, the batches are timed with the
+ * TIM2 microsecond counter : the caller needs read access to TIM2. The
+ * shortest batch is kept, and the loop around the calls is included.
+ *
+ * @param None
+ * @return The cycles of one `task_set_threshold` call.
+ */
+uint32_t svc_measure_service_cycles(void);
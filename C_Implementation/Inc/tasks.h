@@ -11,6 +11,8 @@
 
 #include <stdint.h>
 
+#define TASK_NO_PREEMPTION    0xFFU       // Preemption threshold that no task priority exceeds
+
 
 /**
  * @brief Initializes the Main Stack Pointer (MSP) for the scheduler.
@@ -42,7 +44,8 @@ __attribute__((naked)) void sched_stack_init(uint32_t);
  * - Prepares the stack frame by storing:
  *   - xPSR (Program Status Register) to indicate the Thumb state.
  *   - The address of the task handler function (PC).
- *   - The link register (LR) value.
+ *   - The link register (LR) value : `task_exit`, so a task function that
+ *     returns ends the task instead of jumping to an invalid address.
  *   - Initializes general-purpose registers (R0 to R12) to zero.
  * 
  * @param None
@@ -104,6 +107,10 @@ void task4_routine(void);
  *
  * @details
  * - This routine simulates task scheduling in a multitasking environment.
+ * - It first runs `boot_post_start`, the initialization deferred until
+ *   after the scheduler started.
+ * - It drains the deferred log rings with `log_drain`, so log output only
+ *   uses the CPU time no other task wants.
  * 
  * @param None
  * @return None
@@ -127,7 +134,184 @@ void idle_routine(void);
  * 
  * 
  * @note The idle task (task 0) cannot be delayed.
+ * @note Unprivileged tasks call it through `SVC_TASK_DELAY`, as the other
+ *       services that take an SVC number in svc.h.
+ * 
+ * @return None
+ */
+void task_delay(uint32_t delay_tick);
+
+/**
+ * @brief Blocks the current task until it is notified or the timeout expires.
+ * 
+ * This function puts the currently running task in the `WAITING` state until another 
+ * task or an interrupt handler calls `task_notify` on it. A notification sent while the 
+ * task was not waiting is kept, and makes the next call return immediately.
+ *
+ * @param timeout_tick The maximum number of system ticks to wait, 0 to wait forever.
+ *
+ * @details
+ * - The pending notification is consumed by the call.
+ * - With a timeout, the task is woken up by `check_blocked_tasks` like a delayed task.
+ *
+ * @note The idle task (task 0) cannot wait, the call returns the pending notification at once.
  * 
+ * @return 1 if the task was notified, 0 if the timeout expired.
+ */
+uint8_t task_notify_wait(uint32_t timeout_tick);
+
+/**
+ * @brief First half of `task_notify_wait` : blocks the current task unless a notification is pending.
+ *
+ * Called directly by privileged tasks and by the `SVC_TASK_WAIT` service.
+ * The context switch happens when the call, or the SVC, returns.
+ *
+ * @param timeout_tick The maximum number of system ticks to wait, 0 to wait forever.
  * @return None
  */
-void task_delay(uint32_t delay_tick);
\ No newline at end of file
+void task_wait_begin(uint32_t timeout_tick);
+
+/**
+ * @brief Second half of `task_notify_wait` : consumes the pending notification of the current task.
+ *
+ * @param None
+ * @return 1 if the task was notified, 0 otherwise.
+ */
+uint8_t task_take_notify(void);
+
+/**
+ * @brief Notifies a task, waking it up if it is waiting for a notification.
+ * 
+ * This function marks a notification as pending for `task`. If the task is in the 
+ * `WAITING` state it becomes `RUNNING` again and a PendSV is triggered so the scheduler 
+ * reconsiders its choice.
+ *
+ * @param task The index of the task to notify, out of range values are ignored.
+ *
+ * @note Safe to call from tasks and interrupt handlers.
+ * 
+ * @return None
+ */
+void task_notify(uint8_t task);
+
+/**
+ * @brief Returns the high-water mark of a task stack.
+ * 
+ * The stacks are filled with `STACK_FILL_PATTERN` by `init_tasks_stack`. This function 
+ * scans the stack of `task` from its lowest address up to the first overwritten word.
+ *
+ * @param task The index of the task.
+ * 
+ * @return The maximum number of stack bytes used by the task so far.
+ */
+uint32_t task_stack_used(uint8_t task);
+
+/**
+ * @brief Starts a new task on a stack taken from the task stack pool.
+ *
+ * The task takes a free slot above `STATIC_TASKS` and a `TASK_STACK_SIZE`
+ * block from `mem_stack_alloc`. It is ready at once, and its stack is given back to
+ * the pool once it exits. Use it for transient work (firmware update,
+ * calibration) that should not reserve a stack for ever.
+ *
+ * @param task_function The function run by the task. It may return, which exits the task.
+ *
+ * @note The task runs privileged.
+ *
+ * @return The index of the new task, or -1 if no slot or no stack is free.
+ */
+int8_t task_create(void (*task_function)(void));
+
+/**
+ * @brief Ends the calling task.
+ *
+ * The task leaves the ready set for good and the scheduler switches away.
+ * The stack of a task started by `task_create` returns to the stack pool
+ * at that switch, a static task keeps its stack and may be restarted.
+ *
+ * @note This function is also the return address of every task function.
+ * @note The idle task must not exit.
+ *
+ * @return Does not return.
+ */
+void task_exit(void);
+
+/**
+ * @brief Removes a task from the ready set until `task_resume` is called.
+ *
+ * A task may suspend itself. A delay or a notification wait in progress is
+ * abandoned : after `task_resume`, `task_delay` returns early and
+ * `task_notify_wait` returns the pending notification, if any.
+ *
+ * @param task The index of the task, the idle task cannot be suspended. Out of range values are ignored.
+ * @return None
+ */
+void task_suspend(uint8_t task);
+
+/**
+ * @brief Makes a task suspended by `task_suspend` ready again.
+ *
+ * @param task The index of the task, out of range values are ignored.
+ * @return None
+ */
+void task_resume(uint8_t task);
+
+/**
+ * @brief Restarts a task from the beginning of its function, with a fresh stack frame.
+ *
+ * Works on running, blocked, suspended and exited static tasks. A task may
+ * restart itself : the frame is then rebuilt by PendSV once the task is
+ * switched out, and the call does not return.
+ *
+ * @param task The index of the task.
+ *
+ * @return 0 on success, -1 for the idle task, an index out of range, or an exited task whose stack
+ *         was given back (start it again with `task_create`).
+ */
+int8_t task_restart(uint8_t task);
+
+/**
+ * @brief Completes the lifecycle operations of a task that was just switched out.
+ *
+ * Called by `update_next_task` in PendSV, when the task no longer runs on its
+ * stack : rebuilds the frame of a task that restarted itself and gives the
+ * stack of an exited dynamic task back to the stack pool.
+ *
+ * @param task The index of the outgoing task.
+ * @return None
+ */
+void task_on_switch_out(uint8_t task);
+
+/**
+ * @brief Sets the preemption threshold of the calling task.
+ *
+ * While the threshold is above the task priority, the task is preempted only
+ * by ready tasks with a priority above the threshold : time slicing and tasks
+ * up to the threshold wait until it blocks or lowers the threshold again.
+ * Tasks that cooperate closely can thus run to completion against each other
+ * and still yield to urgent tasks, with fewer context switches.
+ *
+ * @code
+ * uint8_t saved = task_set_threshold(TASK_NO_PREEMPTION);
+ * // short region that must not be preempted by other tasks
+ * task_set_threshold(saved);
+ * @endcode
+ *
+ * @param threshold The new threshold, values below the task priority restore normal preemption.
+ *
+ * @note Interrupts are not masked : this is not a critical section.
+ *
+ * @return The previous threshold, to be restored later.
+ */
+uint8_t task_set_threshold(uint8_t threshold);
+
+/**
+ * @brief Returns the cost of a scheduler service called by task 3.
+ *
+ * Task 3 runs `svc_measure_service_cycles` when it starts. Under
+ * `MPU_ISOLATION` it is unprivileged, so this is the full SVC path.
+ *
+ * @param None
+ * @return The cycles of one `task_set_threshold` call, 0 until task 3 has run.
+ */
+uint32_t task_svc_cycles(void);
@@ -0,0 +1,97 @@
+/**
+ * @file timer.h
+ * @brief Header file for the hardware timebase of the Embedded Scheduler Project.
+ *
+ * This file contains the TIM2 register definitions and the function prototypes
+ * of the free-running microsecond timebase used for short delays and
+ * high-resolution timestamps.
+ *
+ * @author Bilel
+ * @date 2024-10-28
+ */
+
+#include <stdint.h>
+
+#define TIM2_BASE     0x40000000  // Base address for TIM2 (32-bit general purpose timer)
+
+// Define offset for registers
+#define RCC_APB1ENR   (*(volatile uint32_t *)(RCC_BASE + 0x40)) // APB1 peripheral clock enable register
+#define TIM2_CR1      (*(volatile uint32_t *)(TIM2_BASE + 0x00)) // TIM2 control register 1
+#define TIM2_EGR      (*(volatile uint32_t *)(TIM2_BASE + 0x14)) // TIM2 event generation register
+#define TIM2_CNT      (*(volatile uint32_t *)(TIM2_BASE + 0x24)) // TIM2 counter
+#define TIM2_PSC      (*(volatile uint32_t *)(TIM2_BASE + 0x28)) // TIM2 prescaler
+#define TIM2_ARR      (*(volatile uint32_t *)(TIM2_BASE + 0x2C)) // TIM2 auto-reload register
+
+// Core debug cycle counter
+#define DEMCR         (*(volatile uint32_t *)0xE000EDFC) // Debug exception and monitor control register
+#define DWT_CTRL      (*(volatile uint32_t *)0xE0001000) // DWT control register
+#define DWT_CYCCNT    (*(volatile uint32_t *)0xE0001004) // DWT cycle count register
+
+#define TIMER_FREQUENCY_HZ        1000000U  // Timebase resolution : 1 count per microsecond
+#define TICK_PERIOD_US            (TIMER_FREQUENCY_HZ / SYSTEM_TICK_RATE_HZ) // Length of one system tick in microseconds
+#define DELAY_US_YIELD_THRESHOLD  TICK_PERIOD_US // Waits at least this long are handed to the scheduler
+
+/**
+ * @brief Initializes TIM2 as a free-running 32-bit microsecond counter.
+ *
+ * The steps include:
+ *
+ * 1. Enabling the clock for TIM2 by setting the appropriate bit in the
+ *    RCC_APB1ENR register.
+ * 2. Loading the prescaler so that the counter advances once per microsecond
+ *    from the HSI clock, and the auto-reload register with its maximum value
+ *    so the counter wraps around after 2^32 microseconds.
+ * 3. Generating an update event to latch the prescaler and starting the counter.
+ * 4. Making sure the DWT cycle counter read by `timer_cycles` runs. It is
+ *    not cleared : Reset_Handler starts it and boot phases count from reset.
+ *
+ * @note This function must be called before `timer_now_us` or `delay_us` are used.
+ *
+ * @param None
+ * @return None
+ */
+void timer_init(void);
+
+/**
+ * @brief Returns the current value of the microsecond timebase.
+ *
+ * The value is independent of `SYSTEM_TICK_RATE_HZ` and wraps around every
+ * 2^32 microseconds (about 71 minutes). Durations must be computed with an
+ * unsigned subtraction (`end - start`) to stay correct across the wrap.
+ *
+ * @param None
+ * @return The elapsed time since `timer_init` in microseconds.
+ */
+uint32_t timer_now_us(void);
+
+/**
+ * @brief Returns the number of CPU cycles elapsed, from the DWT cycle counter.
+ *
+ * Used to measure short sections, such as the scheduler overheads, with a
+ * resolution of one core clock. The counter wraps around every 2^32 cycles,
+ * durations must be computed with an unsigned subtraction.
+ *
+ * @param None
+ * @return The current value of DWT_CYCCNT.
+ */
+uint32_t timer_cycles(void);
+
+/**
+ * @brief Delays the caller for the specified number of microseconds.
+ *
+ * Short waits spin on the TIM2 counter. When the requested duration is at
+ * least `DELAY_US_YIELD_THRESHOLD` and the caller is a task, the whole ticks
+ * contained in the wait are handed to the scheduler through `task_delay`, so
+ * other tasks use the CPU meanwhile, and only the remainder is spent spinning.
+ *
+ * @param us The number of microseconds to wait.
+ *
+ * @details
+ * - The delay never ends early : the final busy wait is always measured from
+ *   the moment `delay_us` was entered.
+ * - From an interrupt handler, or before the scheduler is started, the whole
+ *   duration is busy waited.
+ *
+ * @return None
+ */
+void delay_us(uint32_t us);
@@ -0,0 +1,123 @@
+/**
+ * @file uart.h
+ * @brief Header file for the USART2 driver.
+ *
+ * This file contains the register definitions and function prototypes of the
+ * USART2 driver. Transmission goes through a ring buffer drained by DMA1
+ * Stream 6, so writers never wait for the line. Reception is interrupt driven
+ * into a small ring buffer.
+ *
+ * USART2 uses PA2 (TX) and PA3 (RX), 115200 baud, 8N1.
+ *
+ * @author Bilel
+ * @date 2024-10-28
+ */
+
+#include <stdint.h>
+
+#define GPIOA_BASE    0x40020000  // Base address for GPIOA
+#define USART2_BASE   0x40004400  // Base address for USART2
+#define DMA1_BASE     0x40026000  // Base address for DMA1
+#define NVIC_ISER_BASE 0xE000E100 // Base address for the NVIC interrupt set-enable registers
+
+// Define offset for registers
+#define GPIOA_MODER   (*(volatile uint32_t *)(GPIOA_BASE + 0x00)) // GPIO port mode register
+#define GPIOA_AFRL    (*(volatile uint32_t *)(GPIOA_BASE + 0x20)) // GPIO alternate function low register
+#define USART2_SR     (*(volatile uint32_t *)(USART2_BASE + 0x00)) // USART status register
+#define USART2_DR     (*(volatile uint32_t *)(USART2_BASE + 0x04)) // USART data register
+#define USART2_BRR    (*(volatile uint32_t *)(USART2_BASE + 0x08)) // USART baud rate register
+#define USART2_CR1    (*(volatile uint32_t *)(USART2_BASE + 0x0C)) // USART control register 1
+#define USART2_CR3    (*(volatile uint32_t *)(USART2_BASE + 0x14)) // USART control register 3
+#define DMA1_HISR     (*(volatile uint32_t *)(DMA1_BASE + 0x04)) // DMA high interrupt status register
+#define DMA1_HIFCR    (*(volatile uint32_t *)(DMA1_BASE + 0x0C)) // DMA high interrupt flag clear register
+#define DMA1_S6CR     (*(volatile uint32_t *)(DMA1_BASE + 0xA0)) // DMA stream 6 configuration register
+#define DMA1_S6NDTR   (*(volatile uint32_t *)(DMA1_BASE + 0xA4)) // DMA stream 6 number of data register
+#define DMA1_S6PAR    (*(volatile uint32_t *)(DMA1_BASE + 0xA8)) // DMA stream 6 peripheral address register
+#define DMA1_S6M0AR   (*(volatile uint32_t *)(DMA1_BASE + 0xAC)) // DMA stream 6 memory 0 address register
+#define NVIC_ISER(n)  (*(volatile uint32_t *)(NVIC_ISER_BASE + 4 * (n))) // NVIC interrupt set-enable register n
+
+#define DMA1_STREAM6_IRQ      17U         // DMA1 Stream 6 interrupt number
+#define USART2_IRQ            38U         // USART2 interrupt number
+
+#define UART_BAUD_RATE        115200U     // Line speed in bits per second
+#define UART_TX_BUFFER_SIZE   1024U       // Size of the transmit ring buffer in bytes
+#define UART_RX_BUFFER_SIZE   64U         // Size of the receive ring buffer in bytes
+
+// Set UART_TX_DMA to 0 to drain the transmit ring from the TXE interrupt, e.g. under QEMU which does not emulate the DMA
+#ifndef UART_TX_DMA
+#define UART_TX_DMA           1
+#endif
+
+/**
+ * @brief Initializes USART2, its pins, the transmit DMA stream and the interrupts.
+ *
+ * The steps include:
+ *
+ * 1. Enabling the clocks of GPIOA, DMA1 and USART2.
+ * 2. Configuring PA2 and PA3 in alternate function 7 (USART2).
+ * 3. Setting the baud rate from the HSI clock and enabling the transmitter,
+ *    the receiver, the RXNE interrupt and the DMA transmit requests.
+ * 4. Pointing DMA1 Stream 6 (channel 4) at the data register, memory to
+ *    peripheral with memory increment and transfer complete interrupt.
+ *
+ * Data written before the call is kept in the ring and sent once the driver
+ * is initialized.
+ *
+ * @param None
+ * @return None
+ */
+void uart_init(void);
+
+/**
+ * @brief Queues bytes for transmission without waiting.
+ *
+ * The bytes are copied into the transmit ring and a DMA transfer is started
+ * if none is in progress. Bytes that do not fit in the ring are dropped and
+ * counted, the caller never blocks.
+ *
+ * @param data The bytes to send.
+ * @param len The number of bytes to send.
+ * @return The number of bytes queued.
+ *
+ * @note Safe to call from tasks and interrupt handlers.
+ */
+uint32_t uart_write(const char *data, uint32_t len);
+
+/**
+ * @brief Queues a binary frame whole, or not at all.
+ *
+ * The free space is checked and the frame copied under the same critical
+ * section, so text written by other tasks cannot cut it. Nothing is counted
+ * as dropped when the frame does not fit : the caller keeps it and retries.
+ *
+ * @param data The bytes of the frame.
+ * @param len The length of the frame.
+ * @return 1 if the frame was queued, 0 if the ring cannot take it now.
+ *
+ * @note Safe to call from tasks and interrupt handlers.
+ */
+uint32_t uart_write_frame(const char *data, uint32_t len);
+
+/**
+ * @brief Reads one received byte without waiting.
+ *
+ * @param None
+ * @return The byte read, or -1 if the receive ring is empty.
+ */
+int uart_read_byte(void);
+
+/**
+ * @brief Selects the task notified when a byte is received.
+ *
+ * @param task The index of the task to notify with `task_notify`, or 0 for none.
+ * @return None
+ */
+void uart_set_rx_task(uint8_t task);
+
+/**
+ * @brief Returns the number of bytes dropped because the transmit ring was full.
+ *
+ * @param None
+ * @return The number of dropped bytes since boot.
+ */
+uint32_t uart_dropped_bytes(void);
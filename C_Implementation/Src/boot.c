@@ -0,0 +1,42 @@
+/**
+ * @file boot.c
+ * @brief Implementation of the boot instrumentation and deferred initialization.
+ *
+ * @author Bilel
+ * @date 2024-10-28
+ */
+
+#include "boot.h"
+#include "timer.h"
+#include "profiler.h"
+#include "svc.h"
+#include "main.h"
+
+
+// Written by Reset_Handler before .bss is cleared, so it must not be in .bss
+uint32_t g_boot_cycles[BOOT_MARKS] NOINIT;
+
+extern uint32_t g_svc_cycles;
+
+// Initialized data : valid once Reset_Handler copied .data, the marks it records are reached
+static uint8_t boot_reached = (1 << (BOOT_MARK_CONSTRUCTORS + 1)) - 1;
+
+
+void boot_mark(uint8_t mark) {
+  g_boot_cycles[mark] = DWT_CYCCNT;
+  boot_reached |= (1 << mark);
+}
+
+uint8_t boot_cycles(uint8_t mark, uint32_t *cycles) {
+  *cycles = g_boot_cycles[mark];
+  return (boot_reached >> mark) & 1;
+}
+
+void boot_post_start(void) {
+#if PROFILER_ENABLE
+  profiler_init();
+#endif
+  g_svc_cycles = svc_measure_cycles();
+
+  boot_mark(BOOT_MARK_POST_START);
+}
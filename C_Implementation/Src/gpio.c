@@ -23,9 +23,4 @@ void gpio_init(void) {
 
 void toggle_gpio_pin(uint32_t pin) {
     GPIOD_ODR ^= pin; // Toggle D12 using XOR
-}
-
-void delay(volatile uint32_t count) { //TODO remplace with timer
-    while (count--) {
-    }
 }
\ No newline at end of file
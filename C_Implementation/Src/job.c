@@ -0,0 +1,152 @@
+/**
+ * @file job.c
+ * @brief Implementation of the stackless job executor.
+ *
+ * @author Bilel
+ * @date 2024-10-28
+ */
+
+#include <stddef.h>
+#include "job.h"
+#include "tasks.h"
+#include "main.h"
+
+
+extern uint32_t g_tick_count;
+
+static Job *jobs[JOB_MAX_JOBS];
+static uint32_t job_count = 0;
+static uint32_t last_dispatched = 0;
+
+
+int job_register(Job *job, JobFunction job_function, uint8_t priority, void *context) {
+  job->resume_point = 0;
+  job->priority = priority;
+  job->job_state = JOB_READY;
+  job->notified = 0;
+  job->wake_tick = 0;
+  job->job_function = job_function;
+  job->context = context;
+
+  uint32_t primask = enter_critical();
+  if (job_count >= JOB_MAX_JOBS) {
+    exit_critical(primask);
+    return -1;
+  }
+  jobs[job_count++] = job;
+  exit_critical(primask);
+
+  task_notify(JOB_EXECUTOR_TASK);
+  return 0;
+}
+
+void job_notify(Job *job) {
+  uint32_t primask = enter_critical();
+
+  job->notified = 1;
+  if (job->job_state == JOB_WAITING) {
+    job->job_state = JOB_READY;
+  }
+
+  exit_critical(primask);
+
+  task_notify(JOB_EXECUTOR_TASK);
+}
+
+uint8_t job_sleep(Job *job, uint32_t ticks) {
+  job->wake_tick = g_tick_count + ticks;
+  return JOB_DELAYED;
+}
+
+uint8_t job_take_notify(Job *job) {
+  uint32_t primask = enter_critical();
+  uint8_t notified = job->notified;
+
+  job->notified = 0;
+  exit_critical(primask);
+
+  return notified;
+}
+
+/*
+ * Wakes the delayed jobs that are due and returns the index of the ready job
+ * to dispatch, or -1. The scan starts after the last dispatched job so jobs
+ * of equal priority take turns.
+ */
+static int select_job(void) {
+  int selected = -1;
+
+  for (uint32_t i = 1; i <= job_count; i++) {
+    uint32_t index = (last_dispatched + i) % job_count;
+    Job *job = jobs[index];
+
+    if (job->job_state == JOB_DELAYED && (int32_t)(g_tick_count - job->wake_tick) >= 0) {
+      job->job_state = JOB_READY;
+    }
+
+    if (job->job_state == JOB_READY &&
+        (selected < 0 || job->priority > jobs[selected]->priority)) {
+      selected = index;
+    }
+  }
+
+  return selected;
+}
+
+/*
+ * Ticks until the nearest delayed job is due, negative or null if one became
+ * due since select_job ran. `any_delayed` is cleared when no job is delayed.
+ */
+static int32_t ticks_to_next_wake(uint8_t *any_delayed) {
+  int32_t nearest = 0;
+
+  *any_delayed = 0;
+  for (uint32_t index = 0; index < job_count; index++) {
+    if (jobs[index]->job_state == JOB_DELAYED) {
+      int32_t ticks = (int32_t)(jobs[index]->wake_tick - g_tick_count);
+
+      if (!*any_delayed || ticks < nearest) {
+        nearest = ticks;
+      }
+      *any_delayed = 1;
+    }
+  }
+
+  return nearest;
+}
+
+void job_executor_routine(void) {
+  while (1) {
+    int selected = (job_count > 0) ? select_job() : -1;
+
+    if (selected < 0) {
+      uint8_t any_delayed;
+      int32_t ticks = ticks_to_next_wake(&any_delayed);
+
+      if (!any_delayed) {
+        task_notify_wait(0);
+      } else if (ticks > 0) {
+        task_notify_wait((uint32_t)ticks);
+      }
+      continue;
+    }
+
+    Job *job = jobs[selected];
+    uint8_t new_state = job->job_function(job);
+
+    // A notification may have arrived while the job was deciding to wait
+    uint32_t primask = enter_critical();
+    if (new_state == JOB_WAITING && job->notified) {
+      new_state = JOB_READY;
+    }
+    job->job_state = new_state;
+
+    // A finished job gives its entry back : the last one takes its place
+    if (new_state == JOB_DONE) {
+      jobs[selected] = jobs[--job_count];
+    }
+    exit_critical(primask);
+
+    last_dispatched = selected;
+  }
+}
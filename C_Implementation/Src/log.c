@@ -0,0 +1,117 @@
+/**
+ * @file log.c
+ * @brief Implementation of the deferred binary logger.
+ *
+ * @author Bilel
+ * @date 2024-10-28
+ */
+
+#include "log.h"
+#include "uart.h"
+#include "timer.h"
+#include "main.h"
+
+
+extern uint8_t c_task;
+
+typedef struct
+{
+    volatile uint32_t head;          // Free running, written by the producer only
+    volatile uint32_t tail;          // Free running, written by log_drain only
+    uint32_t dropped;                // Written by the producer only
+    uint32_t dropped_reported;       // Written by log_drain only
+} LogRing;
+
+static LogRing log_rings[TOTAL_TASKS + 1];
+static uint32_t log_words[TOTAL_TASKS + 1][LOG_RING_WORDS] NOINIT;
+
+
+void log_record(const char *fmt, const uint32_t *args, uint32_t nargs) {
+  uint32_t ipsr;
+
+  __asm volatile ("MRS %0, IPSR" : "=r" (ipsr));
+
+  uint32_t ring_index = (ipsr != 0) ? LOG_ISR_RING : c_task;
+  LogRing *ring = &log_rings[ring_index];
+  uint32_t *words = log_words[ring_index];
+  uint32_t head = ring->head;
+
+  if (LOG_RING_WORDS - (head - ring->tail) < LOG_HEADER_WORDS + nargs) {
+    ring->dropped++;
+    return;
+  }
+
+  words[head++ % LOG_RING_WORDS] = (uint32_t)fmt;
+  words[head++ % LOG_RING_WORDS] = (ring_index << 8) | nargs;
+  words[head++ % LOG_RING_WORDS] = timer_now_us();
+  for (uint32_t arg = 0; arg < nargs; arg++) {
+    words[head++ % LOG_RING_WORDS] = args[arg];
+  }
+
+  // Single core : the record only has to be stored before the head
+  __asm volatile ("" ::: "memory");
+  ring->head = head;
+}
+
+/*
+ * Sends one frame, or nothing if the UART ring cannot take all of it.
+ * Returns 0 when the frame did not fit.
+ */
+static uint32_t send_frame(const uint32_t *words, uint32_t count) {
+  uint8_t frame[2 + 4 * (LOG_HEADER_WORDS + LOG_MAX_ARGS)];
+  uint32_t length = 2 + 4 * count;
+
+  frame[0] = LOG_FRAME_SYNC;
+  frame[1] = (uint8_t)count;
+  for (uint32_t word = 0; word < count; word++) {
+    frame[2 + 4 * word] = (uint8_t)words[word];
+    frame[3 + 4 * word] = (uint8_t)(words[word] >> 8);
+    frame[4 + 4 * word] = (uint8_t)(words[word] >> 16);
+    frame[5 + 4 * word] = (uint8_t)(words[word] >> 24);
+  }
+
+  // Text writers may run at any time, the frame is queued whole or not at all
+  return uart_write_frame((const char *)frame, length);
+}
+
+void log_drain(void) {
+  uint32_t record[LOG_HEADER_WORDS + LOG_MAX_ARGS];
+
+  for (uint32_t ring_index = 0; ring_index <= LOG_ISR_RING; ring_index++) {
+    LogRing *ring = &log_rings[ring_index];
+    uint32_t *words = log_words[ring_index];
+    uint32_t dropped = ring->dropped;
+
+    if (dropped != ring->dropped_reported) {
+      record[0] = 0;
+      record[1] = (ring_index << 8) | 1;
+      record[2] = timer_now_us();
+      record[3] = dropped - ring->dropped_reported;
+      if (!send_frame(record, LOG_HEADER_WORDS + 1)) {
+        return;
+      }
+      ring->dropped_reported = dropped;
+    }
+
+    uint32_t tail = ring->tail;
+
+    while (tail != ring->head) {
+      uint32_t count = LOG_HEADER_WORDS + (words[(tail + 1) % LOG_RING_WORDS] & 0xFF);
+
+      for (uint32_t word = 0; word < count; word++) {
+        record[word] = words[(tail + word) % LOG_RING_WORDS];
+      }
+      if (!send_frame(record, count)) {
+        return;
+      }
+
+      tail += count;
+      __asm volatile ("" ::: "memory");
+      ring->tail = tail;
+    }
+  }
+}
+
+uint32_t log_dropped(uint8_t ring) {
+  return log_rings[ring].dropped;
+}
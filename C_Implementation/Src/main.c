@@ -20,9 +20,17 @@
 
 
 #include <stdint.h>
+#include <stddef.h>
 #include "../Inc/main.h"
 #include "../Inc/gpio.h"
 #include "../Inc/tasks.h"
+#include "../Inc/timer.h"
+#include "../Inc/mempool.h"
+#include "../Inc/mlfq.h"
+#include "../Inc/uart.h"
+#include "../Inc/boot.h"
+#include "../Inc/mpu.h"
+#include "../Inc/log.h"
 
 
 
@@ -30,6 +38,10 @@
 TaskControlBlock tasks[TOTAL_TASKS];
 uint8_t c_task = 1 ; //1st task - 0 is the idle task
 uint32_t g_tick_count = 0;
+uint32_t g_switch_time_us = 0; // Timestamp of the last context switch
+uint32_t g_tick_cycles_max = 0;   // Longest SysTick_Handler body, in CPU cycles
+uint32_t g_switch_cycles_max = 0; // Longest update_next_task, in CPU cycles
+uint32_t g_switch_count = 0;      // Context switches that changed the running task
 
 
 
@@ -39,16 +51,37 @@ int main(void)
 
   enable_faults();
 
+  mempool_init();
+
   gpio_init();
 
+  timer_init();
+
+  // Started here, not in boot_post_start : busy tasks may keep the idle task out for long
+  uart_init();
+
+  boot_mark(BOOT_MARK_DRIVERS);
+
   sched_stack_init(SCHEDULER_STACK_START);
 
   init_tasks_stack();
 
+#if SCHED_POLICY == SCHED_POLICY_MLFQ
+  mlfq_init();
+#endif
+
+#if MPU_ISOLATION
+  mpu_init();
+#endif
+
+  boot_mark(BOOT_MARK_TASKS);
+
   systick_T_init(SYSTEM_TICK_RATE_HZ);
 
   switch_sp_to_psp();
 
+  boot_mark(BOOT_MARK_FIRST_TASK);
+
   task1_routine();
 	for(;;);
 }
@@ -61,7 +94,8 @@ void increment_tick(void){
 
 void check_blocked_tasks(void){
   for(int task = 0 ; task < TOTAL_TASKS ; task++){
-    if ( tasks[task].task_state == BLOCKED) {
+    if ( tasks[task].task_state == BLOCKED ||
+        ( tasks[task].task_state == WAITING && tasks[task].wait_timed ) ) {
       if( tasks[task].remaining_ticks == g_tick_count ){
         tasks[task].task_state = RUNNING;
       }
@@ -78,7 +112,42 @@ void set_psp_value(uint32_t task_psp){
   tasks[c_task].stack_pointer = task_psp;
 }
 
-void update_next_task(void) {
+/*
+ * A running task whose preemption threshold is raised above its priority
+ * keeps the CPU, unless a ready task has a priority above the threshold.
+ */
+static uint8_t threshold_holds(void) {
+    if (c_task == 0 || tasks[c_task].task_state != RUNNING ||
+        tasks[c_task].preempt_threshold <= tasks[c_task].priority) {
+        return 0;
+    }
+
+    for (int task = 1; task < TOTAL_TASKS; task++) {
+        if (task != c_task && tasks[task].task_state == RUNNING &&
+            tasks[task].priority > tasks[c_task].preempt_threshold) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void select_next_task(void) {
+#if SCHED_POLICY == SCHED_POLICY_MLFQ
+    mlfq_select_next();
+#elif SCHED_POLICY == SCHED_POLICY_PRIORITY
+    uint8_t best = 0;
+
+    // Highest priority ready task, the scan starts after c_task so equal priorities take turns
+    for (int step = 1; step <= TOTAL_TASKS; step++) {
+        uint8_t task = (c_task + step) % TOTAL_TASKS;
+
+        if (task != 0 && tasks[task].task_state == RUNNING &&
+            (best == 0 || tasks[task].priority > tasks[best].priority)) {
+            best = task;
+        }
+    }
+    c_task = best;
+#else
     uint8_t found_task = 0;
 
     for (int task = 0; task < TOTAL_TASKS; task++) {
@@ -95,6 +164,44 @@ void update_next_task(void) {
     if (!found_task) {
         c_task = 0;
     }
+#endif
+}
+
+void update_next_task(void) {
+    uint32_t start = timer_cycles();
+    uint32_t now = timer_now_us();
+    uint32_t slice = now - g_switch_time_us;
+    uint8_t previous = c_task;
+
+    tasks[c_task].run_time_us += slice;
+    tasks[c_task].activation_us += slice;
+    g_switch_time_us = now;
+
+    // A task leaving the ready set has completed its activation
+    if (tasks[c_task].task_state != RUNNING) {
+        if (tasks[c_task].activation_us > tasks[c_task].wcet_us) {
+            tasks[c_task].wcet_us = tasks[c_task].activation_us;
+        }
+        tasks[c_task].activation_us = 0;
+    }
+
+    task_on_switch_out(c_task);
+
+    if (!threshold_holds()) {
+        select_next_task();
+    }
+
+    if (c_task != previous) {
+        g_switch_count++;
+#if MPU_ISOLATION
+        mpu_switch(c_task);
+#endif
+    }
+
+    uint32_t cycles = timer_cycles() - start;
+    if (cycles > g_switch_cycles_max) {
+        g_switch_cycles_max = cycles;
+    }
 }
 
 __attribute__((naked)) void switch_sp_to_psp(void)
@@ -142,11 +249,33 @@ void trig_pendsv(){
   *ICSR |= (1 << 28);
 }
 
+uint32_t enter_critical(void) {
+  uint32_t primask;
+
+  __asm volatile ("MRS %0, PRIMASK" : "=r" (primask));
+  __asm volatile ("CPSID I" ::: "memory");
+  return primask;
+}
+
+void exit_critical(uint32_t primask) {
+  __asm volatile ("MSR PRIMASK, %0" :: "r" (primask) : "memory");
+}
+
 /************ HAndlers *************************** */
 void SysTick_Handler(void) {
+  uint32_t start = timer_cycles();
+
   increment_tick();
+#if SCHED_POLICY == SCHED_POLICY_MLFQ
+  mlfq_on_tick();
+#endif
   check_blocked_tasks();
   trig_pendsv();
+
+  uint32_t cycles = timer_cycles() - start;
+  if (cycles > g_tick_cycles_max) {
+    g_tick_cycles_max = cycles;
+  }
 }
 
 __attribute__((naked)) void PendSV_Handler() {
@@ -169,6 +298,30 @@ void HardFault_Handler(void) {
 }
 
 void MemManage_Handler(void) {
+  uint32_t *ICSR = (uint32_t*)0xE000ED04;
+  uint8_t *MMFSR = (uint8_t*)0xE000ED28;  // Memory management fault status, low byte of CFSR
+  uint32_t *MMFAR = (uint32_t*)0xE000ED34; // Faulting address, valid when MMFSR.MMARVALID is set
+  uint32_t control;
+
+  __asm volatile ("MRS %0, CONTROL" : "=r" (control));
+
+  // Returning to an unprivileged task (RETTOBASE and nPRIV) : the task faulted, end it alone
+  if ((*ICSR & (1 << 11)) && (control & 0x1)) {
+    uint8_t status = *MMFSR;
+
+    LOG("task %u ended by a memory fault, MMFSR 0x%02x, address %p", c_task, status,
+        (status & (1 << 7)) ? (void *)*MMFAR : NULL);
+    *MMFSR = status; // write one to clear
+    tasks[c_task].task_state = EXITED;
+
+    // On a stacking fault (MSTKERR) the PSP is already below the stack region, and
+    // PendSV would save R4-R11 over whatever lies there : move it back to the top
+    __asm volatile ("MSR PSP, %0" :: "r" (tasks[c_task].stack_top));
+
+    trig_pendsv(); // tail-chained, the faulting frame is never unstacked
+    return;
+  }
+
   while(1) {
     
   }
@@ -0,0 +1,251 @@
+/**
+ * @file mempool.c
+ * @brief Implementation of the fixed-block memory pools.
+ *
+ * This file implements the kernel memory pools and routes the C library
+ * allocator (`malloc`, `free`, `calloc`, `realloc` and their reentrant
+ * variants) to them, so the newlib heap grown through `_sbrk` is never used.
+ *
+ * @author Bilel
+ * @date 2024-10-28
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include "mempool.h"
+#include "main.h"
+
+
+static uint64_t pool0_storage[(MEMPOOL_CLASS0_SIZE * MEMPOOL_CLASS0_COUNT) / 8] NOINIT;
+static uint64_t pool1_storage[(MEMPOOL_CLASS1_SIZE * MEMPOOL_CLASS1_COUNT) / 8] NOINIT;
+static uint64_t pool2_storage[(MEMPOOL_CLASS2_SIZE * MEMPOOL_CLASS2_COUNT) / 8] NOINIT;
+static uint64_t pool3_storage[(MEMPOOL_CLASS3_SIZE * MEMPOOL_CLASS3_COUNT) / 8] NOINIT;
+static uint64_t pool4_storage[(MEMPOOL_CLASS4_SIZE * MEMPOOL_CLASS4_COUNT) / 8] NOINIT;
+static uint64_t pool5_storage[(MEMPOOL_CLASS5_SIZE * MEMPOOL_CLASS5_COUNT) / 8] NOINIT;
+static uint64_t stack_storage[(MEMPOOL_STACK_SIZE * MEMPOOL_STACK_COUNT) / 8] NOINIT;
+
+// Misuse of the allocator is a bug of the caller : stop here, as the fault handlers do
+#define MEMPOOL_ASSERT(condition) do { if (!(condition)) { while (1) { } } } while (0)
+
+static MemPool pools[MEMPOOL_CLASSES] = {
+  { MEMPOOL_CLASS0_SIZE, MEMPOOL_CLASS0_COUNT, (uint8_t *)pool0_storage },
+  { MEMPOOL_CLASS1_SIZE, MEMPOOL_CLASS1_COUNT, (uint8_t *)pool1_storage },
+  { MEMPOOL_CLASS2_SIZE, MEMPOOL_CLASS2_COUNT, (uint8_t *)pool2_storage },
+  { MEMPOOL_CLASS3_SIZE, MEMPOOL_CLASS3_COUNT, (uint8_t *)pool3_storage },
+  { MEMPOOL_CLASS4_SIZE, MEMPOOL_CLASS4_COUNT, (uint8_t *)pool4_storage },
+  { MEMPOOL_CLASS5_SIZE, MEMPOOL_CLASS5_COUNT, (uint8_t *)pool5_storage },
+};
+// Task stacks, out of reach of mem_alloc and malloc
+static MemPool stack_pool = { MEMPOOL_STACK_SIZE, MEMPOOL_STACK_COUNT, (uint8_t *)stack_storage };
+static uint32_t oversize_failures = 0;   // Requests larger than the largest class
+
+
+static void pool_init(MemPool *pool) {
+  uint8_t *block = pool->storage;
+
+  // Chain every block to the following one, the last one ends the list
+  for (uint32_t i = 0; i < pool->block_count - 1; i++) {
+    *(void **)block = block + pool->block_size;
+    block += pool->block_size;
+  }
+  *(void **)block = NULL;
+
+  pool->free_list = pool->storage;
+  pool->used = 0;
+  pool->peak_used = 0;
+  pool->largest_request = 0;
+  pool->failures = 0;
+}
+
+/*
+ * Takes the first free block of a pool, or NULL. Must be called with
+ * interrupts masked.
+ */
+static void *pool_take(MemPool *pool, uint32_t size) {
+  void *block = pool->free_list;
+
+  if (block != NULL) {
+    pool->free_list = *(void **)block;
+    pool->used++;
+    if (pool->used > pool->peak_used) {
+      pool->peak_used = pool->used;
+    }
+    if (size > pool->largest_request) {
+      pool->largest_request = size;
+    }
+  }
+  return block;
+}
+
+static void pool_give(MemPool *pool, void *block) {
+  // Only the first byte of a block may be freed, and only while it is allocated
+  MEMPOOL_ASSERT(((uint8_t *)block - pool->storage) % pool->block_size == 0);
+
+  uint32_t primask = enter_critical();
+  MEMPOOL_ASSERT(pool->used != 0);
+  *(void **)block = pool->free_list;
+  pool->free_list = block;
+  pool->used--;
+  exit_critical(primask);
+}
+
+void mempool_init(void) {
+  for (int pool_class = 0; pool_class < MEMPOOL_CLASSES; pool_class++) {
+    pool_init(&pools[pool_class]);
+  }
+  pool_init(&stack_pool);
+  oversize_failures = 0;
+}
+
+static MemPool *find_pool(void *block) {
+  for (int pool_class = 0; pool_class < MEMPOOL_CLASSES; pool_class++) {
+    uint8_t *start = pools[pool_class].storage;
+    uint8_t *end = start + pools[pool_class].block_size * pools[pool_class].block_count;
+
+    if ((uint8_t *)block >= start && (uint8_t *)block < end) {
+      return &pools[pool_class];
+    }
+  }
+  return NULL;
+}
+
+void *mem_alloc(uint32_t size) {
+  MemPool *fitting = NULL;
+  void *block = NULL;
+  uint32_t primask = enter_critical();
+
+  for (int pool_class = 0; pool_class < MEMPOOL_CLASSES; pool_class++) {
+    MemPool *pool = &pools[pool_class];
+
+    if (pool->block_size < size) {
+      continue;
+    }
+    if (fitting == NULL) {
+      fitting = pool;
+    }
+    block = pool_take(pool, size);
+    if (block != NULL) {
+      break;
+    }
+  }
+
+  if (block == NULL) {
+    if (fitting != NULL) {
+      fitting->failures++;
+    } else {
+      oversize_failures++;
+    }
+  }
+
+  exit_critical(primask);
+  return block;
+}
+
+void mem_free(void *block) {
+  MemPool *pool = find_pool(block);
+
+  if (pool == NULL) {
+    return;
+  }
+  pool_give(pool, block);
+}
+
+void *mem_stack_alloc(void) {
+  uint32_t primask = enter_critical();
+  void *stack = pool_take(&stack_pool, MEMPOOL_STACK_SIZE);
+
+  if (stack == NULL) {
+    stack_pool.failures++;
+  }
+  exit_critical(primask);
+  return stack;
+}
+
+void mem_stack_free(void *stack) {
+  uint8_t *start = stack_pool.storage;
+
+  if ((uint8_t *)stack < start || (uint8_t *)stack >= start + MEMPOOL_STACK_SIZE * MEMPOOL_STACK_COUNT) {
+    return;
+  }
+  pool_give(&stack_pool, stack);
+}
+
+uint32_t mem_block_size(void *block) {
+  MemPool *pool = find_pool(block);
+
+  return (pool != NULL) ? pool->block_size : 0;
+}
+
+uint32_t mempool_oversize_failures(void) {
+  return oversize_failures;
+}
+
+const MemPool *mempool_stats(uint8_t pool_class) {
+  if (pool_class == MEMPOOL_STACK_POOL) {
+    return &stack_pool;
+  }
+  if (pool_class >= MEMPOOL_CLASSES) {
+    return NULL;
+  }
+  return &pools[pool_class];
+}
+
+
+/************ C library allocator *************************** */
+struct _reent;
+
+void *_malloc_r(struct _reent *reent, size_t size) {
+  (void)reent;
+  return mem_alloc(size);
+}
+
+void _free_r(struct _reent *reent, void *block) {
+  (void)reent;
+  mem_free(block);
+}
+
+void *_calloc_r(struct _reent *reent, size_t count, size_t size) {
+  (void)reent;
+  if (size != 0 && count > UINT32_MAX / size) {
+    return NULL;
+  }
+
+  void *block = mem_alloc(count * size);
+
+  if (block != NULL) {
+    memset(block, 0, count * size);
+  }
+  return block;
+}
+
+void *_realloc_r(struct _reent *reent, void *block, size_t size) {
+  (void)reent;
+  uint32_t old_size = mem_block_size(block);
+
+  if (block != NULL && size <= old_size) {
+    return block;
+  }
+
+  void *new_block = mem_alloc(size);
+  if (new_block != NULL && block != NULL) {
+    memcpy(new_block, block, old_size);
+    mem_free(block);
+  }
+  return new_block;
+}
+
+void *malloc(size_t size) {
+  return _malloc_r(NULL, size);
+}
+
+void free(void *block) {
+  _free_r(NULL, block);
+}
+
+void *calloc(size_t count, size_t size) {
+  return _calloc_r(NULL, count, size);
+}
+
+void *realloc(void *block, size_t size) {
+  return _realloc_r(NULL, block, size);
+}
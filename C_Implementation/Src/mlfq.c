@@ -0,0 +1,83 @@
+/**
+ * @file mlfq.c
+ * @brief Implementation of the multi-level feedback queue scheduling policy.
+ *
+ * @author Bilel
+ * @date 2024-10-28
+ */
+
+#include "mlfq.h"
+#include "main.h"
+
+
+extern TaskControlBlock tasks[TOTAL_TASKS];
+extern uint8_t c_task;
+extern uint32_t g_tick_count;
+
+#define MLFQ_SLICE(level)   (MLFQ_BASE_SLICE_TICKS << (level))
+
+
+void mlfq_init(void) {
+  for (int task = 0; task < TOTAL_TASKS; task++) {
+    tasks[task].mlfq_level = 0;
+    tasks[task].slice_left = MLFQ_SLICE(0);
+  }
+}
+
+void mlfq_on_tick(void) {
+  if ((g_tick_count % MLFQ_BOOST_PERIOD_TICKS) == 0) {
+    for (int task = 0; task < TOTAL_TASKS; task++) {
+      tasks[task].mlfq_level = 0;
+    }
+  }
+
+  if (c_task == 0 || tasks[c_task].task_state != RUNNING) {
+    return;
+  }
+
+  if (tasks[c_task].slice_left > 0) {
+    tasks[c_task].slice_left--;
+  }
+  if (tasks[c_task].slice_left == 0 && tasks[c_task].mlfq_level < MLFQ_LEVELS - 1) {
+    tasks[c_task].mlfq_level++;
+  }
+}
+
+void mlfq_on_block(void) {
+  if (tasks[c_task].slice_left > 0 && tasks[c_task].mlfq_level > 0) {
+    tasks[c_task].mlfq_level--;
+  }
+}
+
+void mlfq_select_next(void) {
+  uint8_t best_level = MLFQ_LEVELS;
+
+  // Highest level holding a runnable task, the idle task does not count
+  for (int task = 1; task < TOTAL_TASKS; task++) {
+    if (tasks[task].task_state == RUNNING && tasks[task].mlfq_level < best_level) {
+      best_level = tasks[task].mlfq_level;
+    }
+  }
+
+  if (best_level == MLFQ_LEVELS) {
+    c_task = 0;
+    return;
+  }
+
+  // Keep the current task until its slice is over or a higher level wakes up
+  if (c_task != 0 && tasks[c_task].task_state == RUNNING &&
+      tasks[c_task].slice_left > 0 && tasks[c_task].mlfq_level == best_level) {
+    return;
+  }
+
+  for (int task = 0; task < TOTAL_TASKS; task++) {
+    c_task = (c_task + 1) % TOTAL_TASKS;
+
+    if (c_task != 0 && tasks[c_task].task_state == RUNNING &&
+        tasks[c_task].mlfq_level == best_level) {
+      break;
+    }
+  }
+
+  tasks[c_task].slice_left = MLFQ_SLICE(best_level);
+}
@@ -0,0 +1,54 @@
+/**
+ * @file mpu.c
+ * @brief Implementation of the task isolation with the MPU.
+ *
+ * @author Bilel
+ * @date 2024-10-28
+ */
+
+#include "mpu.h"
+#include "main.h"
+
+#define FLASH_BASE        0x08000000U
+#define FLASH_SIZE_LOG2   20U         // 1 MB
+
+extern TaskControlBlock tasks[TOTAL_TASKS];
+
+
+void mpu_init(void) {
+  MPU_RBAR = FLASH_BASE | MPU_RBAR_VALID | MPU_FLASH_REGION;
+  MPU_RASR = MPU_AP_USER_RO | MPU_NORMAL | MPU_SIZE(FLASH_SIZE_LOG2) | MPU_RASR_ENABLE;
+
+  MPU_CTRL = MPU_CTRL_PRIVDEFENA | MPU_CTRL_ENABLE;
+  __asm volatile ("DSB");
+  __asm volatile ("ISB");
+}
+
+void mpu_task_region(uint8_t task, uint8_t region, uint32_t base, uint32_t size_log2, uint32_t attributes) {
+  tasks[task].mpu_rbar[region] = base | MPU_RBAR_VALID | (MPU_TASK_REGION + region);
+  tasks[task].mpu_rasr[region] = attributes | MPU_SIZE(size_log2) | MPU_RASR_ENABLE;
+}
+
+void mpu_task_data(uint8_t task, void *data) {
+  mpu_task_region(task, MPU_DATA_SLOT, (uint32_t)data, MPU_TASK_DATA_LOG2, MPU_AP_FULL | MPU_XN | MPU_NORMAL);
+}
+
+void mpu_switch(uint8_t task) {
+  uint32_t control;
+
+  __asm volatile ("MRS %0, CONTROL" : "=r" (control));
+
+  if (!tasks[task].unprivileged) {
+    __asm volatile ("MSR CONTROL, %0" :: "r" (control & ~0x1U));
+    return;
+  }
+
+  MPU_RBAR = (tasks[task].stack_top - TASK_STACK_SIZE) | MPU_RBAR_VALID | MPU_STACK_REGION;
+  MPU_RASR = MPU_AP_FULL | MPU_XN | MPU_NORMAL | MPU_SIZE(MPU_STACK_SIZE_LOG2) | MPU_RASR_ENABLE;
+  for (uint32_t region = 0; region < TASK_MPU_REGIONS; region++) {
+    MPU_RBAR = tasks[task].mpu_rbar[region] | MPU_RBAR_VALID | (MPU_TASK_REGION + region);
+    MPU_RASR = tasks[task].mpu_rasr[region];
+  }
+
+  __asm volatile ("MSR CONTROL, %0" :: "r" (control | 0x1U));
+}
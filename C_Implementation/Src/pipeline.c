@@ -0,0 +1,114 @@
+/**
+ * @file pipeline.c
+ * @brief Implementation of the zero-copy DMA buffer pipeline.
+ *
+ * @author Bilel
+ * @date 2024-10-28
+ */
+
+#include <stddef.h>
+#include "pipeline.h"
+#include "tasks.h"
+#include "main.h"
+
+
+int pipe_init(Pipe *pipe, void *storage, uint32_t buffer_size, uint8_t buffer_count, uint8_t consumer_task) {
+  if (buffer_count < 3 || buffer_count > PIPE_MAX_BUFFERS) {
+    return -1;
+  }
+
+  for (uint8_t buffer = 0; buffer < buffer_count; buffer++) {
+    pipe->free_buffers[buffer] = (uint8_t *)storage + buffer * buffer_size;
+  }
+  pipe->free_count = buffer_count;
+  pipe->filled_head = 0;
+  pipe->filled_count = 0;
+  pipe->dma_target[0] = NULL;
+  pipe->dma_target[1] = NULL;
+  pipe->stream_base = 0;
+  pipe->consumer_task = consumer_task;
+  pipe->delivered = 0;
+  pipe->overruns = 0;
+
+  return 0;
+}
+
+void pipe_dma_start(Pipe *pipe, uint32_t stream_base, uint8_t channel,
+                    uint32_t peripheral_address, uint32_t transfers, uint8_t data_size) {
+  uint32_t primask = enter_critical();
+
+  pipe->stream_base = stream_base;
+  pipe->dma_target[0] = pipe->free_buffers[--pipe->free_count];
+  pipe->dma_target[1] = pipe->free_buffers[--pipe->free_count];
+
+  exit_critical(primask);
+
+  DMA_SxCR(stream_base) &= ~(1 << 0);
+  while (DMA_SxCR(stream_base) & (1 << 0)) {
+  }
+
+  DMA_SxPAR(stream_base) = peripheral_address;
+  DMA_SxM0AR(stream_base) = (uint32_t)pipe->dma_target[0];
+  DMA_SxM1AR(stream_base) = (uint32_t)pipe->dma_target[1];
+  DMA_SxNDTR(stream_base) = transfers;
+
+  // CHSEL / DBM / MSIZE / PSIZE / MINC / CIRC / DIR = peripheral to memory / TCIE
+  DMA_SxCR(stream_base) = ((uint32_t)channel << 25) | (1 << 18) |
+                          ((uint32_t)data_size << 13) | ((uint32_t)data_size << 11) |
+                          (1 << 10) | (1 << 8) | (1 << 4);
+  DMA_SxCR(stream_base) |= (1 << 0);
+}
+
+void pipe_dma_isr(Pipe *pipe) {
+  // CT is the target in use now, the other one has just been filled
+  uint8_t completed = (DMA_SxCR(pipe->stream_base) & (1 << 19)) ? 0 : 1;
+
+  if (pipe->free_count == 0) {
+    pipe->overruns++;
+    return;
+  }
+
+  void *fresh = pipe->free_buffers[--pipe->free_count];
+
+  pipe->filled[(pipe->filled_head + pipe->filled_count) % PIPE_MAX_BUFFERS] = pipe->dma_target[completed];
+  pipe->filled_count++;
+  pipe->delivered++;
+
+  pipe->dma_target[completed] = fresh;
+  if (completed == 0) {
+    DMA_SxM0AR(pipe->stream_base) = (uint32_t)fresh;
+  } else {
+    DMA_SxM1AR(pipe->stream_base) = (uint32_t)fresh;
+  }
+
+  task_notify(pipe->consumer_task);
+}
+
+void *pipe_acquire(Pipe *pipe, uint32_t timeout_tick) {
+  while (1) {
+    uint32_t primask = enter_critical();
+
+    if (pipe->filled_count > 0) {
+      void *buffer = pipe->filled[pipe->filled_head];
+
+      pipe->filled_head = (pipe->filled_head + 1) % PIPE_MAX_BUFFERS;
+      pipe->filled_count--;
+      exit_critical(primask);
+      return buffer;
+    }
+
+    exit_critical(primask);
+
+    if (!task_notify_wait(timeout_tick)) {
+      return NULL;
+    }
+  }
+}
+
+void pipe_release(Pipe *pipe, void *buffer) {
+  uint32_t primask = enter_critical();
+
+  pipe->free_buffers[pipe->free_count++] = buffer;
+
+  exit_critical(primask);
+}
@@ -0,0 +1,117 @@
+/**
+ * @file profiler.c
+ * @brief Implementation of the statistical PC-sampling profiler.
+ *
+ * @author Bilel
+ * @date 2024-10-28
+ */
+
+#include "profiler.h"
+#include "gpio.h"
+#include "uart.h"
+#include "timer.h"
+#include "main.h"
+
+#if PROFILER_ENABLE
+
+extern uint8_t c_task;
+
+typedef struct
+{
+    uint32_t pc;
+    uint32_t lr;
+    uint32_t task;
+} ProfileSample;
+
+static ProfileSample samples[PROFILER_RING_SAMPLES] NOINIT;
+static volatile uint32_t sample_head = 0;   // Written by the TIM7 handler only
+static volatile uint32_t sample_tail = 0;   // Written by profiler_drain only
+static uint32_t lost_samples = 0;
+
+
+void profiler_init(void) {
+  // Step 1: Enable the clock for TIM7
+  RCC_APB1ENR |= (1 << 5);
+
+  // Step 2: Count at 1 MHz, update event every 1/PROFILER_SAMPLE_HZ seconds
+  TIM7_PSC = (HSI_CLOCK_FREQUENCY_HZ / TIMER_FREQUENCY_HZ) - 1;
+  TIM7_ARR = (TIMER_FREQUENCY_HZ / PROFILER_SAMPLE_HZ) - 1;
+
+  // Step 3: Update interrupt (UIE), then start the counter (CEN)
+  TIM7_DIER |= (1 << 0);
+  NVIC_ISER(TIM7_IRQ / 32) = (1 << (TIM7_IRQ % 32));
+  TIM7_CR1 |= (1 << 0);
+}
+
+void profiler_sample(uint32_t *frame) {
+  uint32_t head = sample_head;
+
+  TIM7_SR = 0;                         // clear UIF
+
+  if (head - sample_tail >= PROFILER_RING_SAMPLES) {
+    lost_samples++;
+    return;
+  }
+
+  samples[head % PROFILER_RING_SAMPLES].pc = frame[6];
+  samples[head % PROFILER_RING_SAMPLES].lr = frame[5];
+  samples[head % PROFILER_RING_SAMPLES].task = c_task;
+
+  __asm volatile ("" ::: "memory");
+  sample_head = head + 1;
+}
+
+void profiler_drain(void) {
+  uint8_t frame[2 + sizeof(ProfileSample) * PROFILER_FRAME_SAMPLES];
+
+  while (sample_tail != sample_head) {
+    uint32_t tail = sample_tail;
+    uint32_t count = sample_head - tail;
+
+    if (count > PROFILER_FRAME_SAMPLES) {
+      count = PROFILER_FRAME_SAMPLES;
+    }
+    frame[0] = PROFILER_FRAME_SYNC;
+    frame[1] = (uint8_t)count;
+    for (uint32_t sample = 0; sample < count; sample++) {
+      const uint32_t *words = (const uint32_t *)&samples[(tail + sample) % PROFILER_RING_SAMPLES];
+
+      for (uint32_t word = 0; word < 3; word++) {
+        uint8_t *out = &frame[2 + 12 * sample + 4 * word];
+
+        out[0] = (uint8_t)words[word];
+        out[1] = (uint8_t)(words[word] >> 8);
+        out[2] = (uint8_t)(words[word] >> 16);
+        out[3] = (uint8_t)(words[word] >> 24);
+      }
+    }
+
+    // Queued whole or kept for the next call, text writers cannot cut it
+    if (!uart_write_frame((const char *)frame, 2 + sizeof(ProfileSample) * count)) {
+      return;
+    }
+
+    __asm volatile ("" ::: "memory");
+    sample_tail = tail + count;
+  }
+}
+
+uint32_t profiler_lost_samples(void) {
+  return lost_samples;
+}
+
+
+/************ Handlers *************************** */
+/*
+ * Finds the stack the interrupted code used from EXC_RETURN (bit 2 : PSP)
+ * and tail-calls profiler_sample with it, LR still holding EXC_RETURN.
+ */
+__attribute__((naked)) void TIM7_IRQHandler(void) {
+  __asm volatile ("TST LR, #4");
+  __asm volatile ("ITE EQ");
+  __asm volatile ("MRSEQ R0, MSP");
+  __asm volatile ("MRSNE R0, PSP");
+  __asm volatile ("B profiler_sample");
+}
+
+#endif /* PROFILER_ENABLE */
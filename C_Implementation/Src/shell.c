@@ -0,0 +1,188 @@
+/**
+ * @file shell.c
+ * @brief Implementation of the runtime statistics shell.
+ *
+ * @author Bilel
+ * @date 2024-10-28
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "shell.h"
+#include "uart.h"
+#include "tasks.h"
+#include "timer.h"
+#include "mempool.h"
+#include "boot.h"
+#include "svc.h"
+#include "main.h"
+
+
+extern TaskControlBlock tasks[TOTAL_TASKS];
+extern uint8_t c_task;
+extern uint32_t g_tick_count;
+extern uint32_t g_tick_cycles_max;
+extern uint32_t g_switch_cycles_max;
+extern uint32_t g_switch_count;
+extern uint32_t g_svc_cycles;
+
+static const char *task_names[TOTAL_TASKS] = { "idle", "task1", "task2", "task3", "task4", "jobs", "shell", "dyn7", "dyn8" };
+
+static const char *boot_mark_names[BOOT_MARKS] = {
+  "SystemInit", ".data copy", ".bss zero", "constructors",
+  "drivers", "task setup", "first task", "post start"
+};
+
+static uint32_t last_run_time_us[TOTAL_TASKS];
+static uint32_t last_refresh_us = 0;
+
+
+static void shell_print(const char *text) {
+  uart_write(text, strlen(text));
+}
+
+static const char *state_name(uint8_t task) {
+  if (task == c_task) {
+    return "RUN";
+  }
+  switch (tasks[task].task_state) {
+    case RUNNING: return "READY";
+    case BLOCKED: return "DELAY";
+    case WAITING: return "WAIT";
+    case SUSPENDED: return "SUSP";
+    case EXITED:  return "EXIT";
+    default:      return "?";
+  }
+}
+
+static void print_top(void) {
+  char line[80];
+  uint32_t now = timer_now_us();
+  uint32_t elapsed = now - last_refresh_us;
+
+  snprintf(line, sizeof(line), "\r\n tick %lu   tx dropped %lu\r\n",
+           (unsigned long)g_tick_count, (unsigned long)uart_dropped_bytes());
+  shell_print(line);
+  snprintf(line, sizeof(line), " overhead tick %lu cyc   switch %lu cyc   switches %lu\r\n",
+           (unsigned long)g_tick_cycles_max, (unsigned long)g_switch_cycles_max,
+           (unsigned long)g_switch_count);
+  shell_print(line);
+  shell_print(" ID NAME   STATE   CPU%   STACK      WCET us\r\n");
+
+  for (uint8_t task = 0; task < TOTAL_TASKS; task++) {
+    if (tasks[task].stack_top == 0) {
+      continue; // free slot
+    }
+
+    uint32_t run_time = tasks[task].run_time_us - last_run_time_us[task];
+    uint32_t share = (elapsed != 0) ? (uint32_t)(((uint64_t)run_time * 1000) / elapsed) : 0;
+
+    last_run_time_us[task] = tasks[task].run_time_us;
+    snprintf(line, sizeof(line), " %2u %-6s %-6s %3lu.%lu %5lu/%u %10lu\r\n",
+             task, task_names[task], state_name(task),
+             (unsigned long)(share / 10), (unsigned long)(share % 10),
+             (unsigned long)task_stack_used(task), TASK_STACK_SIZE,
+             (unsigned long)tasks[task].wcet_us);
+    shell_print(line);
+  }
+
+  for (uint8_t pool_class = 0; pool_class <= MEMPOOL_CLASSES; pool_class++) {
+    // The stack pool comes last
+    const MemPool *pool = mempool_stats(pool_class < MEMPOOL_CLASSES ? pool_class : MEMPOOL_STACK_POOL);
+
+    snprintf(line, sizeof(line), " %s %4lu B  used %2lu/%2lu  peak %2lu  fail %lu\r\n",
+             pool_class < MEMPOOL_CLASSES ? "pool " : "stack",
+             (unsigned long)pool->block_size, (unsigned long)pool->used,
+             (unsigned long)pool->block_count, (unsigned long)pool->peak_used,
+             (unsigned long)pool->failures);
+    shell_print(line);
+  }
+  snprintf(line, sizeof(line), " pool oversize requests %lu\r\n",
+           (unsigned long)mempool_oversize_failures());
+  shell_print(line);
+
+  last_refresh_us = now;
+}
+
+static void print_boot(void) {
+  char line[80];
+  uint32_t previous = 0;
+
+  shell_print(" PHASE         CYCLES     DELTA  FROM RESET us\r\n");
+  for (uint8_t mark = 0; mark < BOOT_MARKS; mark++) {
+    uint32_t cycles;
+
+    if (!boot_cycles(mark, &cycles)) {
+      continue;
+    }
+    snprintf(line, sizeof(line), " %-12s %8lu  %8lu  %13lu\r\n", boot_mark_names[mark],
+             (unsigned long)cycles, (unsigned long)(cycles - previous),
+             (unsigned long)(cycles / (HSI_CLOCK_FREQUENCY_HZ / 1000000U)));
+    shell_print(line);
+    previous = cycles;
+  }
+
+  snprintf(line, sizeof(line), " svc gate     %8lu cycles SVC_NOP round trip, %s\r\n", (unsigned long)g_svc_cycles,
+           (g_svc_cycles <= SVC_BUDGET_CYCLES) ? "within budget" : "OVER BUDGET");
+  shell_print(line);
+  snprintf(line, sizeof(line), " svc service  %8lu cycles task_set_threshold from task3\r\n",
+           (unsigned long)task_svc_cycles());
+  shell_print(line);
+}
+
+static void execute(const char *command, uint8_t *top_enabled) {
+  if (strcmp(command, "top") == 0) {
+    *top_enabled = 1;
+    print_top();
+  } else if (strcmp(command, "stop") == 0) {
+    *top_enabled = 0;
+  } else if (strcmp(command, "boot") == 0) {
+    print_boot();
+  } else if (strcmp(command, "help") == 0) {
+    shell_print("commands: top, stop, boot, help\r\n");
+  } else {
+    shell_print("unknown command\r\n");
+  }
+}
+
+void shell_routine(void) {
+  char command[SHELL_LINE_SIZE];
+  uint32_t length = 0;
+  uint8_t top_enabled = 0;
+  uint32_t next_refresh = g_tick_count + SHELL_REFRESH_TICKS;
+
+  uart_set_rx_task(SHELL_TASK);
+  shell_print("\r\nscheduler shell, type help\r\n> ");
+
+  while (1) {
+    int32_t ticks_left = (int32_t)(next_refresh - g_tick_count);
+
+    if (ticks_left > 0) {
+      task_notify_wait((uint32_t)ticks_left);
+    }
+
+    int byte;
+    while ((byte = uart_read_byte()) >= 0) {
+      if (byte == '\r' || byte == '\n') {
+        if (length == 0) {
+          continue;
+        }
+        command[length] = '\0';
+        shell_print("\r\n");
+        execute(command, &top_enabled);
+        shell_print("> ");
+        length = 0;
+      } else if (length < SHELL_LINE_SIZE - 1) {
+        command[length++] = (char)byte;
+        uart_write((const char *)&command[length - 1], 1); // echo
+      }
+    }
+
+    if ((int32_t)(g_tick_count - next_refresh) >= 0) {
+      next_refresh = g_tick_count + SHELL_REFRESH_TICKS;
+      if (top_enabled) {
+        print_top();
+      }
+    }
+  }
+}
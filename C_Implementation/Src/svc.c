@@ -0,0 +1,136 @@
+/**
+ * @file svc.c
+ * @brief Implementation of the SVC call gate.
+ *
+ * @author Bilel
+ * @date 2024-10-28
+ */
+
+#include "svc.h"
+#include "tasks.h"
+#include "timer.h"
+#include "main.h"
+
+#define SVC_STRINGIFY(x)  #x
+#define SVC_TO_STRING(x)  SVC_STRINGIFY(x)
+#define SVC_MEASURE_RUNS  8U
+#define SVC_MEASURE_CALLS 64U         // Calls per batch of svc_measure_service_cycles
+
+extern TaskControlBlock tasks[TOTAL_TASKS];
+extern uint8_t c_task;
+extern void trig_pendsv();
+
+
+/*
+ * Arguments come from an unprivileged task and are never trusted : a task
+ * index must name a live task before the kernel writes its TCB.
+ */
+static uint32_t svc_valid_task(uint32_t task) {
+  return task < TOTAL_TASKS && tasks[task].stack_top != 0 && tasks[task].task_state != EXITED;
+}
+
+// Every service receives the exception frame : R0-R3, R12, LR, PC, xPSR
+static void svc_nop(uint32_t *frame) {
+  (void)frame;
+}
+
+static void svc_task_delay(uint32_t *frame) {
+  task_delay(frame[0]);                  // the switch happens when the SVC returns
+}
+
+static void svc_task_wait(uint32_t *frame) {
+  task_wait_begin(frame[0]);
+}
+
+static void svc_task_take_notify(uint32_t *frame) {
+  frame[0] = task_take_notify();
+}
+
+static void svc_task_notify(uint32_t *frame) {
+  if (svc_valid_task(frame[0])) {
+    task_notify((uint8_t)frame[0]);
+  }
+}
+
+static void svc_task_exit(uint32_t *frame) {
+  (void)frame;
+  tasks[c_task].task_state = EXITED;
+  trig_pendsv();
+}
+
+static void svc_task_set_threshold(uint32_t *frame) {
+  uint32_t threshold = frame[0];
+
+  // Thresholds are 8-bit, saturate rather than wrap a larger value
+  frame[0] = task_set_threshold(threshold > TASK_NO_PREEMPTION ? TASK_NO_PREEMPTION : (uint8_t)threshold);
+}
+
+void (* const svc_table[SVC_COUNT])(uint32_t *frame) = {
+  svc_nop, svc_task_delay, svc_task_wait, svc_task_take_notify,
+  svc_task_notify, svc_task_exit, svc_task_set_threshold
+};
+
+
+uint32_t g_svc_cycles = 0;   // Round trip of SVC_NOP, measured by boot_post_start
+
+
+uint32_t svc_measure_cycles(void) {
+  uint32_t best = UINT32_MAX;
+
+  // The shortest run is the one no interrupt came into
+  for (uint32_t run = 0; run < SVC_MEASURE_RUNS; run++) {
+    uint32_t start = timer_cycles();
+    uint32_t empty = timer_cycles() - start;
+
+    start = timer_cycles();
+    SVC_CALL(SVC_NOP, 0);
+    uint32_t cycles = (timer_cycles() - start) - empty;
+
+    if (cycles < best) {
+      best = cycles;
+    }
+  }
+  return best;
+}
+
+
+uint32_t svc_measure_service_cycles(void) {
+  uint32_t best = UINT32_MAX;
+
+  for (uint32_t run = 0; run < SVC_MEASURE_RUNS; run++) {
+    uint32_t start = timer_now_us();
+
+    for (uint32_t call = 0; call < SVC_MEASURE_CALLS; call++) {
+      task_set_threshold(0);             // clamped to the priority : no change, no switch
+    }
+
+    uint32_t elapsed = timer_now_us() - start;
+    if (elapsed < best) {
+      best = elapsed;
+    }
+  }
+  return best * (HSI_CLOCK_FREQUENCY_HZ / TIMER_FREQUENCY_HZ) / SVC_MEASURE_CALLS;
+}
+
+
+/************ Handlers *************************** */
+/*
+ * Picks the stack of the caller from EXC_RETURN (bit 2 : PSP), reads the SVC
+ * immediate behind the stacked PC and tail-calls the service with the frame,
+ * LR still holding EXC_RETURN. Unknown numbers return at once.
+ */
+__attribute__((naked)) void SVC_Handler(void) {
+  __asm volatile ("TST LR, #4");
+  __asm volatile ("ITE EQ");
+  __asm volatile ("MRSEQ R0, MSP");
+  __asm volatile ("MRSNE R0, PSP");
+  __asm volatile ("LDR R1, [R0, #24]");          // stacked PC, after the SVC instruction
+  __asm volatile ("LDRB R1, [R1, #-2]");         // SVC immediate
+  __asm volatile ("CMP R1, #" SVC_TO_STRING(SVC_COUNT));
+  __asm volatile ("IT HS");
+  __asm volatile ("BXHS LR");
+  __asm volatile ("MOVW R2, #:lower16:svc_table");
+  __asm volatile ("MOVT R2, #:upper16:svc_table");
+  __asm volatile ("LDR R2, [R2, R1, LSL #2]");
+  __asm volatile ("BX R2");
+}
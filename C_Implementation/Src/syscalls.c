@@ -29,6 +29,7 @@
 #include <time.h>
 #include <sys/time.h>
 #include <sys/times.h>
+#include "uart.h"
 
 
 /* Variables */
@@ -77,15 +78,12 @@ __attribute__((weak)) int _read(int file, char *ptr, int len)
   return len;
 }
 
+/* Non-blocking : the bytes are queued in the USART2 transmit ring, see uart.h */
 __attribute__((weak)) int _write(int file, char *ptr, int len)
 {
   (void)file;
-  int DataIdx;
 
-  for (DataIdx = 0; DataIdx < len; DataIdx++)
-  {
-    __io_putchar(*ptr++);
-  }
+  uart_write(ptr, len);
   return len;
 }
 
@@ -9,17 +9,42 @@
  * @date 2024-10-28
  */
 
+#include <stddef.h>
 #include "tasks.h"
 #include "gpio.h"
 #include "main.h"
+#include "mlfq.h"
+#include "job.h"
+#include "shell.h"
+#include "log.h"
+#include "boot.h"
+#include "mempool.h"
+#include "profiler.h"
+#include "svc.h"
+#include "mpu.h"
+#include "timer.h"
 
 
 extern TaskControlBlock tasks[TOTAL_TASKS];
 extern uint8_t c_task;
 extern uint32_t g_tick_count;
-uint32_t psp_of_tasks[TOTAL_TASKS] = {IDLE_STACK_START ,TASK1_STACK_START , TASK2_STACK_START , TASK3_STACK_START , TASK4_STACK_START};
+uint32_t psp_of_tasks[STATIC_TASKS] = {IDLE_STACK_START ,TASK1_STACK_START , TASK2_STACK_START , TASK3_STACK_START , TASK4_STACK_START , JOB_EXECUTOR_STACK_START , SHELL_STACK_START};
 // Define task_handlers as an array of pointers to functions returning void
-void (*task_handlers[TOTAL_TASKS])(void) = { idle_routine, task1_routine, task2_routine, task3_routine, task4_routine };
+void (*task_handlers[STATIC_TASKS])(void) = { idle_routine, task1_routine, task2_routine, task3_routine, task4_routine, job_executor_routine, shell_routine };
+uint8_t task_priorities[STATIC_TASKS] = { 0, 2, 2, 2, 2, 2, 1 };
+// Tasks run without privilege under MPU_ISOLATION, task 1 is started by main and stays privileged
+uint8_t task_unprivileged[STATIC_TASKS] = { 0, 0, 0, 1, 1, 0, 0 };
+
+// State of the LED tasks, in the data block their MPU region covers
+typedef struct MPU_TASK_DATA
+{
+    uint32_t toggles;            // LED toggles since boot
+    uint32_t svc_cycles;         // task_set_threshold call measured by task 3, see svc.h
+} LedTaskData;
+
+static LedTaskData task3_data;
+static LedTaskData task4_data;
+static void *task_data[STATIC_TASKS] = { NULL, NULL, NULL, &task3_data, &task4_data, NULL, NULL };
 extern void trig_pendsv();
 
 void task1_routine(void) {
@@ -28,7 +53,6 @@ void task1_routine(void) {
     /* code */
     toggle_gpio_pin(GPIO_PIN_D12);
     task_delay(2);
-    //delay(10000);
   }
   
 }
@@ -39,18 +63,20 @@ void task2_routine(void) {
     /* code */
     toggle_gpio_pin(GPIO_PIN_D13);
     task_delay(4);
-    //delay(20000);
   }
   
 }
 
 void task3_routine(void) {
+  // Measured from here : under MPU_ISOLATION the task runs unprivileged and pays the SVC
+  task3_data.svc_cycles = svc_measure_service_cycles();
+
   while (1)
   {
     /* code */
     toggle_gpio_pin(GPIO_PIN_D14);
+    task3_data.toggles++;
     task_delay(6);
-    //delay(30000);
   }
   
 }
@@ -60,17 +86,25 @@ void task4_routine(void) {
   {
     /* code */
     toggle_gpio_pin(GPIO_PIN_D15);
+    task4_data.toggles++;
     task_delay(8);
-    //delay(40000);
   }
   
 }
 
 void idle_routine(void) {
   int idle = 0;
+
+  // First time nothing else is ready : run the init the tasks did not need
+  boot_post_start();
+
   while (1)
   {
     idle++;
+    log_drain(); // lowest priority, logging never delays the other tasks
+#if PROFILER_ENABLE
+    profiler_drain();
+#endif
   }
   
 }
@@ -78,36 +112,68 @@ void idle_routine(void) {
 
 
 
-void init_tasks_stack(void) {
+/*
+ * Builds the initial frame of a task at the top of its stack, as if it had
+ * been preempted just before the first instruction of its function, and
+ * paints the rest of the stack. The task is made ready last.
+ */
+static void init_task_frame(uint8_t task) {
+  uint32_t *PSP = (uint32_t*)tasks[task].stack_top;
 
-  for (int task=0 ; task< TOTAL_TASKS ; task++) {
-    tasks[task].task_state = RUNNING;
-    tasks[task].stack_pointer = psp_of_tasks[task];
-    tasks[task].task_function = task_handlers[task];
+  // Paint the stack below the initial frame, for task_stack_used
+  for (uint32_t *word = (uint32_t*)(tasks[task].stack_top - TASK_STACK_SIZE) ; word < PSP - 16 ; word++) {
+    *word = STACK_FILL_PATTERN;
   }
-  uint32_t *PSP;
-
 
   //Stack frame : xPSR / PC / LR / General purpose registers R12 -> R0 / Scratch registers R11 -> R4
-  for (int task=0 ; task < TOTAL_TASKS ; task++) {
-    PSP = (uint32_t*)tasks[task].stack_pointer;
+  PSP--;
+  *PSP = xPSR; //0x00100000 T (thumb state) bit of PSR register
 
-    PSP--;
-    *PSP = xPSR; //0x00100000 T (thumb state) bit of PSR register
+  PSP--;
+  *PSP = tasks[task].task_function; //PC next instruction to execute is the task handler
 
-    PSP--;
-    *PSP = tasks[task].task_function; //PC next instruction to execute is the task handler
+  PSP--;
+  *PSP = (uint32_t)task_exit; //LR : return trampoline, a task returning from its function exits
 
+  for (int reg = 0 ; reg < 13 ; reg++) {
     PSP--;
-    *PSP = 0xFFFFFFFD; //LR
+    *PSP = 0;
+  }
 
-    for (int reg = 0 ; reg < 13 ; reg++) {
-      PSP--;
-      *PSP = 0;
-    }
+  tasks[task].stack_pointer = (uint32_t)PSP;
+  tasks[task].notify_pending = 0;
+  tasks[task].wait_timed = 0;
+  tasks[task].activation_us = 0;
+  tasks[task].restart_pending = 0;
+  tasks[task].preempt_threshold = tasks[task].priority;
+#if SCHED_POLICY == SCHED_POLICY_MLFQ
+  tasks[task].mlfq_level = 0;
+  tasks[task].slice_left = MLFQ_BASE_SLICE_TICKS;
+#endif
+  tasks[task].task_state = RUNNING;
+}
 
-    tasks[task].stack_pointer = (uint32_t)PSP;
-    
+void init_tasks_stack(void) {
+
+  for (int task=0 ; task < TOTAL_TASKS ; task++) {
+    if (task < STATIC_TASKS) {
+      tasks[task].stack_top = psp_of_tasks[task];
+      tasks[task].task_function = task_handlers[task];
+      tasks[task].priority = task_priorities[task];
+#if MPU_ISOLATION
+      if (task_unprivileged[task]) {
+        // The LED tasks only need their data block and GPIO port besides their stack
+        tasks[task].unprivileged = 1;
+        mpu_task_data(task, task_data[task]);
+        mpu_task_region(task, 1, GPIOD_BASE, 10, MPU_AP_FULL | MPU_XN | MPU_DEVICE);
+        mpu_task_region(task, 2, TIM2_BASE, 10, MPU_AP_USER_RO | MPU_XN | MPU_DEVICE); // timer_now_us
+      }
+#endif
+      init_task_frame(task);
+    } else {
+      tasks[task].stack_top = 0; // free slot, see task_create
+      tasks[task].task_state = EXITED;
+    }
   }
 }
 
@@ -118,9 +184,232 @@ __attribute__((naked)) void sched_stack_init(uint32_t stack_sched) {
 }
 
 void task_delay(uint32_t delay_tick) {
+  if (svc_caller_unprivileged()) {
+    SVC_CALL(SVC_TASK_DELAY, delay_tick); // the context switch happens on return
+    return;
+  }
+
   if ( c_task != 0 ) {
+#if SCHED_POLICY == SCHED_POLICY_MLFQ
+    mlfq_on_block();
+#endif
     tasks[c_task].remaining_ticks = g_tick_count + delay_tick;
     tasks[c_task].task_state = BLOCKED;
     trig_pendsv();
   }
-}
\ No newline at end of file
+}
+
+void task_wait_begin(uint32_t timeout_tick) {
+  uint32_t primask = enter_critical();
+
+  if ( c_task != 0 && !tasks[c_task].notify_pending ) {
+#if SCHED_POLICY == SCHED_POLICY_MLFQ
+    mlfq_on_block();
+#endif
+    tasks[c_task].wait_timed = (timeout_tick != 0);
+    tasks[c_task].remaining_ticks = g_tick_count + timeout_tick;
+    tasks[c_task].task_state = WAITING;
+    trig_pendsv();
+  }
+  exit_critical(primask); // the context switch happens here, or on return from SVC
+}
+
+uint8_t task_take_notify(void) {
+  uint32_t primask = enter_critical();
+  uint8_t notified = tasks[c_task].notify_pending;
+
+  tasks[c_task].notify_pending = 0;
+  exit_critical(primask);
+
+  return notified;
+}
+
+uint8_t task_notify_wait(uint32_t timeout_tick) {
+  if (svc_caller_unprivileged()) {
+    SVC_CALL(SVC_TASK_WAIT, timeout_tick);
+    return (uint8_t)SVC_CALL(SVC_TASK_TAKE_NOTIFY, 0);
+  }
+
+  task_wait_begin(timeout_tick);
+  return task_take_notify();
+}
+
+void task_notify(uint8_t task) {
+  if (task >= TOTAL_TASKS) {
+    return;
+  }
+
+  if (svc_caller_unprivileged()) {
+    SVC_CALL(SVC_TASK_NOTIFY, task);
+    return;
+  }
+
+  uint32_t primask = enter_critical();
+
+  tasks[task].notify_pending = 1;
+  if ( tasks[task].task_state == WAITING ) {
+    tasks[task].task_state = RUNNING;
+    trig_pendsv();
+  }
+
+  exit_critical(primask);
+}
+
+uint32_t task_stack_used(uint8_t task) {
+  if (tasks[task].stack_top == 0) {
+    return 0;
+  }
+
+  uint32_t *word = (uint32_t*)(tasks[task].stack_top - TASK_STACK_SIZE);
+  uint32_t *top = (uint32_t*)tasks[task].stack_top;
+
+  while (word < top && *word == STACK_FILL_PATTERN) {
+    word++;
+  }
+  return (uint32_t)(top - word) * sizeof(uint32_t);
+}
+
+int8_t task_create(void (*task_function)(void)) {
+  void *stack = mem_stack_alloc();
+  int8_t slot = -1;
+
+  if (stack == NULL) {
+    LOG("task_create: %s", "no free stack");
+    return -1;
+  }
+
+  uint32_t primask = enter_critical();
+
+  for (int task = STATIC_TASKS ; task < TOTAL_TASKS ; task++) {
+    if (tasks[task].task_state == EXITED && tasks[task].stack_top == 0) {
+      slot = task;
+      tasks[task].stack_top = (uint32_t)stack + TASK_STACK_SIZE; // claims the slot
+      break;
+    }
+  }
+
+  exit_critical(primask);
+
+  if (slot < 0) {
+    LOG("task_create: %s", "no free slot");
+    mem_stack_free(stack);
+    return -1;
+  }
+
+  // The slot is EXITED until the frame is complete, the scheduler ignores it
+  tasks[slot].task_function = task_function;
+  tasks[slot].priority = TASK_DEFAULT_PRIORITY;
+  tasks[slot].unprivileged = 0;
+  init_task_frame(slot);
+
+  return slot;
+}
+
+void task_exit(void) {
+  if (svc_caller_unprivileged()) {
+    SVC_CALL(SVC_TASK_EXIT, 0); // CPSID is ignored without privilege
+    while (1) {
+    }
+  }
+
+  uint32_t primask = enter_critical();
+
+  tasks[c_task].task_state = EXITED;
+  trig_pendsv();
+
+  exit_critical(primask); // switched out for good, task_on_switch_out reclaims the stack
+  while (1) {
+  }
+}
+
+void task_suspend(uint8_t task) {
+  if (task == 0 || task >= TOTAL_TASKS) {
+    return;
+  }
+
+  uint32_t primask = enter_critical();
+
+  if (tasks[task].task_state != EXITED) {
+    tasks[task].task_state = SUSPENDED;
+    if (task == c_task) {
+      trig_pendsv();
+    }
+  }
+
+  exit_critical(primask);
+}
+
+void task_resume(uint8_t task) {
+  if (task >= TOTAL_TASKS) {
+    return;
+  }
+
+  uint32_t primask = enter_critical();
+
+  if (tasks[task].task_state == SUSPENDED && !tasks[task].restart_pending) {
+    tasks[task].task_state = RUNNING;
+    trig_pendsv();
+  }
+
+  exit_critical(primask);
+}
+
+int8_t task_restart(uint8_t task) {
+  if (task == 0 || task >= TOTAL_TASKS || tasks[task].stack_top == 0) {
+    return -1;
+  }
+
+  uint32_t primask = enter_critical();
+
+  tasks[task].task_state = SUSPENDED;
+
+  if (task == c_task) {
+    // The frame cannot be rebuilt on the stack in use, PendSV does it
+    tasks[task].restart_pending = 1;
+    trig_pendsv();
+    exit_critical(primask);
+    while (1) {
+    }
+  }
+
+  exit_critical(primask);
+
+  // Suspended and not running : nothing else touches the stack meanwhile
+  init_task_frame(task);
+  trig_pendsv();
+
+  return 0;
+}
+
+void task_on_switch_out(uint8_t task) {
+  if (tasks[task].restart_pending) {
+    init_task_frame(task);
+  } else if (tasks[task].task_state == EXITED && task >= STATIC_TASKS && tasks[task].stack_top != 0) {
+    // Static tasks keep their fixed stack, so task_restart can bring them back
+    mem_stack_free((void*)(tasks[task].stack_top - TASK_STACK_SIZE));
+    tasks[task].stack_top = 0;
+  }
+}
+
+uint32_t task_svc_cycles(void) {
+  return task3_data.svc_cycles;
+}
+
+uint8_t task_set_threshold(uint8_t threshold) {
+  if (svc_caller_unprivileged()) {
+    return (uint8_t)SVC_CALL(SVC_TASK_SET_THRESHOLD, threshold);
+  }
+
+  uint8_t previous = tasks[c_task].preempt_threshold;
+
+  if (threshold < tasks[c_task].priority) {
+    threshold = tasks[c_task].priority;
+  }
+  tasks[c_task].preempt_threshold = threshold;
+
+  // A task held back by the previous threshold may be ready
+  if (threshold < previous) {
+    trig_pendsv();
+  }
+  return previous;
+}
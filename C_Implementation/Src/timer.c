@@ -0,0 +1,68 @@
+/**
+ * @file timer.c
+ * @brief Hardware timebase for the Embedded Scheduler Project.
+ *
+ * This file implements the TIM2 free-running microsecond counter, the
+ * `delay_us` service built on top of it and the timestamp accessor.
+ *
+ * @author Bilel
+ * @date 2024-10-28
+ */
+
+#include "timer.h"
+#include "gpio.h"
+#include "tasks.h"
+#include "main.h"
+
+
+void timer_init(void) {
+    // Step 1: Enable the clock for TIM2
+    RCC_APB1ENR |= (1 << 0); // Bit 0 corresponds to TIM2
+
+    // Step 2: 1 MHz count rate, full 32-bit range
+    TIM2_PSC = (HSI_CLOCK_FREQUENCY_HZ / TIMER_FREQUENCY_HZ) - 1;
+    TIM2_ARR = 0xFFFFFFFF;
+
+    // Step 3: Latch the prescaler (UG) and start the counter (CEN)
+    TIM2_EGR = (1 << 0);
+    TIM2_CR1 |= (1 << 0);
+
+    // Step 4: Enable the trace block (TRCENA) and the cycle counter (CYCCNTENA),
+    // already started by Reset_Handler, which counts from reset for boot.h
+    DEMCR |= (1 << 24);
+    DWT_CTRL |= (1 << 0);
+}
+
+uint32_t timer_now_us(void) {
+    return TIM2_CNT;
+}
+
+uint32_t timer_cycles(void) {
+    return DWT_CYCCNT;
+}
+
+/*
+ * A task runs in thread mode on PSP : IPSR is zero and CONTROL.SPSEL is set.
+ * Anything else (handler mode, main before switch_sp_to_psp) must not block.
+ */
+static uint32_t caller_is_task(void) {
+    uint32_t ipsr, control;
+
+    __asm volatile ("MRS %0, IPSR" : "=r" (ipsr));
+    __asm volatile ("MRS %0, CONTROL" : "=r" (control));
+
+    return (ipsr == 0) && (control & 0x02);
+}
+
+void delay_us(uint32_t us) {
+    uint32_t start = timer_now_us();
+
+    if (us >= DELAY_US_YIELD_THRESHOLD && caller_is_task()) {
+        // task_delay wakes the task up to one tick early, never late,
+        // the busy wait below covers what is left
+        task_delay(us / TICK_PERIOD_US);
+    }
+
+    while ((timer_now_us() - start) < us) {
+    }
+}
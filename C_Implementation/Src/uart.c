@@ -0,0 +1,194 @@
+/**
+ * @file uart.c
+ * @brief USART2 driver with DMA transmission for the Embedded Scheduler Project.
+ *
+ * This file implements the transmit ring drained by DMA1 Stream 6 and the
+ * interrupt driven receive ring.
+ *
+ * @author Bilel
+ * @date 2024-10-28
+ */
+
+#include "uart.h"
+#include "gpio.h"
+#include "timer.h"
+#include "tasks.h"
+#include "main.h"
+
+
+static char tx_buffer[UART_TX_BUFFER_SIZE] NOINIT;
+static uint32_t tx_head = 0;       // Next byte written by uart_write
+static uint32_t tx_tail = 0;       // First byte not yet sent
+static uint32_t tx_in_flight = 0;  // Bytes handed to the running DMA transfer
+static uint32_t tx_dropped = 0;
+
+static char rx_buffer[UART_RX_BUFFER_SIZE];
+static uint32_t rx_head = 0;
+static uint32_t rx_tail = 0;
+static uint8_t rx_task = 0;
+
+static uint8_t uart_ready = 0;
+
+
+// Free space of the transmit ring, one slot stays empty to tell a full ring from an empty one
+static uint32_t tx_space(void) {
+  return (tx_tail + UART_TX_BUFFER_SIZE - tx_head - 1) % UART_TX_BUFFER_SIZE;
+}
+
+
+/*
+ * Hands the next contiguous chunk of the ring to the DMA, or enables the TXE
+ * interrupt that sends it byte by byte without DMA. Must be called with
+ * interrupts masked.
+ */
+static void start_tx(void) {
+  if (!uart_ready || tx_in_flight != 0 || tx_head == tx_tail) {
+    return;
+  }
+
+#if UART_TX_DMA
+  uint32_t chunk = (tx_head > tx_tail) ? (tx_head - tx_tail) : (UART_TX_BUFFER_SIZE - tx_tail);
+
+  tx_in_flight = chunk;
+  DMA1_HIFCR = (0x3D << 16);          // Clear every stream 6 flag
+  DMA1_S6M0AR = (uint32_t)&tx_buffer[tx_tail];
+  DMA1_S6NDTR = chunk;
+  DMA1_S6CR |= (1 << 0);              // EN
+#else
+  USART2_CR1 |= (1 << 7);             // TXEIE, USART2_IRQHandler sends the ring
+#endif
+}
+
+void uart_init(void) {
+  // Step 1: Enable the clocks
+  RCC_AHB1ENR |= (1 << 0) | (1 << 21); // GPIOA, DMA1
+  RCC_APB1ENR |= (1 << 17);            // USART2
+
+  // Step 2: PA2 and PA3 in alternate function mode (10), AF7
+  GPIOA_MODER &= ~((0x3 << (2 * 2)) | (0x3 << (3 * 2)));
+  GPIOA_MODER |= ((0x2 << (2 * 2)) | (0x2 << (3 * 2)));
+  GPIOA_AFRL &= ~((0xF << (2 * 4)) | (0xF << (3 * 4)));
+  GPIOA_AFRL |= ((0x7 << (2 * 4)) | (0x7 << (3 * 4)));
+
+  // Step 3: Baud rate (rounded), DMA transmit requests, UE / TE / RE / RXNEIE
+  USART2_BRR = (HSI_CLOCK_FREQUENCY_HZ + UART_BAUD_RATE / 2) / UART_BAUD_RATE;
+#if UART_TX_DMA
+  USART2_CR3 |= (1 << 7);              // DMAT
+#endif
+  USART2_CR1 |= (1 << 13) | (1 << 3) | (1 << 2) | (1 << 5);
+
+  // Step 4: Stream 6 channel 4, memory to peripheral, memory increment, transfer complete and error interrupts
+  DMA1_S6CR &= ~(1 << 0);
+  while (DMA1_S6CR & (1 << 0)) {
+  }
+  DMA1_S6PAR = (uint32_t)&USART2_DR;
+  DMA1_S6CR = (4 << 25) | (1 << 10) | (1 << 6) | (1 << 4) | (1 << 2); // CHSEL / MINC / DIR / TCIE / TEIE
+
+  NVIC_ISER(DMA1_STREAM6_IRQ / 32) = (1 << (DMA1_STREAM6_IRQ % 32));
+  NVIC_ISER(USART2_IRQ / 32) = (1 << (USART2_IRQ % 32));
+
+  uint32_t primask = enter_critical();
+  uart_ready = 1;
+  start_tx();
+  exit_critical(primask);
+}
+
+uint32_t uart_write(const char *data, uint32_t len) {
+  uint32_t queued = 0;
+  uint32_t primask = enter_critical();
+
+  while (queued < len) {
+    uint32_t next = (tx_head + 1) % UART_TX_BUFFER_SIZE;
+
+    if (next == tx_tail) {
+      tx_dropped += len - queued;
+      break;
+    }
+    tx_buffer[tx_head] = data[queued++];
+    tx_head = next;
+  }
+
+  start_tx();
+  exit_critical(primask);
+
+  return queued;
+}
+
+uint32_t uart_write_frame(const char *data, uint32_t len) {
+  uint32_t primask = enter_critical();
+
+  // Checked and copied in one critical section : no text can slip in between
+  if (tx_space() < len) {
+    exit_critical(primask);
+    return 0;
+  }
+
+  for (uint32_t byte = 0; byte < len; byte++) {
+    tx_buffer[tx_head] = data[byte];
+    tx_head = (tx_head + 1) % UART_TX_BUFFER_SIZE;
+  }
+
+  start_tx();
+  exit_critical(primask);
+
+  return 1;
+}
+
+int uart_read_byte(void) {
+  int byte = -1;
+  uint32_t primask = enter_critical();
+
+  if (rx_tail != rx_head) {
+    byte = (uint8_t)rx_buffer[rx_tail];
+    rx_tail = (rx_tail + 1) % UART_RX_BUFFER_SIZE;
+  }
+
+  exit_critical(primask);
+  return byte;
+}
+
+void uart_set_rx_task(uint8_t task) {
+  rx_task = task;
+}
+
+uint32_t uart_dropped_bytes(void) {
+  return tx_dropped;
+}
+
+
+
+/************ Handlers *************************** */
+void DMA1_Stream6_IRQHandler(void) {
+  // TCIF6 or TEIF6, a failed chunk is dropped rather than retried for ever
+  if (DMA1_HISR & ((1 << 21) | (1 << 19))) {
+    DMA1_HIFCR = (1 << 21) | (1 << 19);
+    tx_tail = (tx_tail + tx_in_flight) % UART_TX_BUFFER_SIZE;
+    tx_in_flight = 0;
+    start_tx();
+  }
+}
+
+void USART2_IRQHandler(void) {
+#if !UART_TX_DMA
+  if ((USART2_CR1 & (1 << 7)) && (USART2_SR & (1 << 7))) { // TXEIE and TXE
+    USART2_DR = tx_buffer[tx_tail];
+    tx_tail = (tx_tail + 1) % UART_TX_BUFFER_SIZE;
+    if (tx_tail == tx_head) {
+      USART2_CR1 &= ~(1 << 7);        // Ring empty, start_tx enables it again
+    }
+  }
+#endif
+
+  if (USART2_SR & (1 << 5)) {         // RXNE, cleared by reading DR
+    char byte = (char)USART2_DR;
+    uint32_t next = (rx_head + 1) % UART_RX_BUFFER_SIZE;
+
+    if (next != rx_tail) {
+      rx_buffer[rx_head] = byte;
+      rx_head = next;
+    }
+    if (rx_task != 0) {
+      task_notify(rx_task);
+    }
+  }
+}
@@ -51,48 +51,96 @@ defined in linker script */
  * @retval : None
 */
 
+/* Record the DWT cycle count for a boot phase, see boot.h */
+.macro BOOT_MARK mark
+  ldr   r0, =0xE0001004 /* DWT_CYCCNT */
+  ldr   r0, [r0]
+  ldr   r1, =g_boot_cycles
+  str   r0, [r1, #(\mark * 4)]
+.endm
+
   .section .text.Reset_Handler
   .weak Reset_Handler
   .type Reset_Handler, %function
 Reset_Handler:
   ldr   r0, =_estack
   mov   sp, r0          /* set stack pointer */
+
+/* Start the DWT cycle counter, boot phases are timed from reset */
+  ldr   r0, =0xE000EDFC /* DEMCR */
+  ldr   r1, [r0]
+  orr   r1, r1, #0x01000000 /* TRCENA */
+  str   r1, [r0]
+  ldr   r0, =0xE0001000 /* DWT_CTRL */
+  movs  r1, #0
+  str   r1, [r0, #4]    /* DWT_CYCCNT */
+  ldr   r1, [r0]
+  orr   r1, r1, #1      /* CYCCNTENA */
+  str   r1, [r0]
+
 /* Call the clock system initialization function.*/
   bl  SystemInit
+  BOOT_MARK 0           /* BOOT_MARK_SYSTEM_INIT */
 
-/* Copy the data segment initializers from flash to SRAM */
+/* Copy the data segment initializers from flash to SRAM, 16 bytes per
+   LDM/STM pair, then the remaining words one by one */
   ldr r0, =_sdata
   ldr r1, =_edata
   ldr r2, =_sidata
-  movs r3, #0
-  b LoopCopyDataInit
+  subs r3, r1, r0
+  b LoopCopyDataBlock
+
+CopyDataBlock:
+  ldmia r2!, {r4-r7}
+  stmia r0!, {r4-r7}
 
-CopyDataInit:
-  ldr r4, [r2, r3]
-  str r4, [r0, r3]
-  adds r3, r3, #4
+LoopCopyDataBlock:
+  subs r3, r3, #16
+  bhs CopyDataBlock
+  adds r3, r3, #16
+  b LoopCopyDataWord
 
-LoopCopyDataInit:
-  adds r4, r0, r3
-  cmp r4, r1
-  bcc CopyDataInit
+CopyDataWord:
+  ldr r4, [r2], #4
+  str r4, [r0], #4
 
-/* Zero fill the bss segment. */
+LoopCopyDataWord:
+  subs r3, r3, #4
+  bhs CopyDataWord
+
+  BOOT_MARK 1           /* BOOT_MARK_DATA */
+
+/* Zero fill the bss segment, 16 bytes per STM, then the remaining words */
   ldr r2, =_sbss
-  ldr r4, =_ebss
+  ldr r1, =_ebss
+  subs r1, r1, r2
   movs r3, #0
-  b LoopFillZerobss
+  movs r4, #0
+  movs r5, #0
+  movs r6, #0
+  b LoopFillZerobssBlock
+
+FillZerobssBlock:
+  stmia r2!, {r3-r6}
+
+LoopFillZerobssBlock:
+  subs r1, r1, #16
+  bhs FillZerobssBlock
+  adds r1, r1, #16
+  b LoopFillZerobssWord
+
+FillZerobssWord:
+  str  r3, [r2], #4
 
-FillZerobss:
-  str  r3, [r2]
-  adds r2, r2, #4
+LoopFillZerobssWord:
+  subs r1, r1, #4
+  bhs FillZerobssWord
 
-LoopFillZerobss:
-  cmp r2, r4
-  bcc FillZerobss
+  BOOT_MARK 2           /* BOOT_MARK_BSS */
 
 /* Call static constructors */
   bl __libc_init_array
+  BOOT_MARK 3           /* BOOT_MARK_CONSTRUCTORS */
 /* Call the application's entry point.*/
   bl main
 
@@ -6,20 +6,21 @@ pub const RAM_SIZE_BYTES: u32 = 128 * 1024; // RAM size in bytes
 // Calculate each task's stack start address
 pub const TASK1_STACK_START: u32 = RAM_START_ADDR + RAM_SIZE_BYTES; 
 pub const TASK2_STACK_START: u32 = TASK1_STACK_START - TASK_STACK_SIZE as u32;
-pub const TASK3_STACK_START: u32 = TASK2_STACK_START - TASK_STACK_SIZE as u32;
-pub const TASK4_STACK_START: u32 = TASK3_STACK_START - TASK_STACK_SIZE as u32;
-pub const IDLE_T_STACK_START: u32 = TASK4_STACK_START - TASK_STACK_SIZE as u32;
+pub const ASYNC_EXEC_STACK_START: u32 = TASK2_STACK_START - TASK_STACK_SIZE as u32; // Shared by all futures
+pub const IDLE_T_STACK_START: u32 = ASYNC_EXEC_STACK_START - TASK_STACK_SIZE as u32;
 pub const SCHEDULER_STACK_START: u32 = IDLE_T_STACK_START - SCHEDULER_STACK_SIZE as u32;
 
 pub const HSI_CLOCK_FREQ_HZ: u32 = 16_000_000;  // High-Speed Internal clock frequency in Hz
 pub const SYSTICK_TICK_RATE_HZ: u32 = 1; // SysTick timer rate in Hz (1 ms)
 
-pub const NUM_TASKS: usize = 5; // Number of tasks
+pub const NUM_TASKS: usize = 4; // Number of tasks
+pub const ASYNC_EXECUTOR_TASK: usize = 3; // Task slot of the async executor
 pub const INITIAL_X_PSR: u32 = 0x01000000; // Initial Program Status Register value with Thumb state bit set
 
 pub const RUNNING:u8        = 0x1;
 #[allow(unused)]
 pub const BLOCKED:u8        = 0x0;
+pub const WAITING:u8        = 0x2; // Blocked until notified
 
 pub static mut GLOBAL_TICK_COUNT: u32 = 0 ;
 
@@ -29,8 +30,13 @@ pub struct TaskControlBlock {
     pub block_count: u32,                 // Block counter
     pub current_state: u8,                // Current state of the task
     pub task_handler: fn(),        // Task handler function pointer
+    pub notify_pending: bool,             // Set by task_notify, consumed by task_notify_wait
 }
 
-pub static mut C_TASK:usize = 1;
+impl TaskControlBlock {
+    pub const fn new(stack_start: u32, task_handler: fn()) -> Self {
+        TaskControlBlock { psp_value: stack_start, block_count: 0, current_state: RUNNING, task_handler, notify_pending: false }
+    }
+}
 
 
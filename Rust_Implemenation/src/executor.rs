@@ -0,0 +1,232 @@
+//! Async executor running inside one scheduler task.
+//!
+//! Futures are pinned in the frame of the executor task and never move, so no
+//! heap is needed. Each future is identified by its index in the table given
+//! to `run`, and its waker simply sets the matching bit of `READY` and
+//! notifies the executor task. While no future is ready the executor task
+//! waits in `task_notify_wait` and costs no CPU.
+//!
+//! Every pending `Sleep` holds one of `MAX_TIMERS` timer slots, so a future
+//! may await several sleeps at once (in a join for example). The slot is
+//! given back when the sleep completes or is dropped.
+
+use core::future::Future;
+use core::pin::Pin;
+use core::sync::atomic::{AtomicBool, AtomicU32, AtomicUsize, Ordering};
+use core::task::{Context, Poll, RawWaker, RawWakerVTable, Waker};
+use crate::consts::{ASYNC_EXECUTOR_TASK, GLOBAL_TICK_COUNT};
+use crate::scheduler::{task_notify, task_notify_wait};
+
+pub const MAX_FUTURES: usize = 32; // One bit of READY per future
+pub const MAX_TIMERS: usize = 32; // Sleeps pending at the same time, one bit of TIMER_USED each
+
+const ZERO: AtomicU32 = AtomicU32::new(0);
+const NO_OWNER: AtomicUsize = AtomicUsize::new(0);
+
+static READY: AtomicU32 = AtomicU32::new(0); // Futures to poll
+static TIMER_USED: AtomicU32 = AtomicU32::new(0); // Timer slots held by a `Sleep`
+static TIMER_ARMED: AtomicU32 = AtomicU32::new(0); // Timer slots checked by `on_tick`
+static DEADLINES: [AtomicU32; MAX_TIMERS] = [ZERO; MAX_TIMERS]; // Wake tick of each timer slot
+static OWNERS: [AtomicUsize; MAX_TIMERS] = [NO_OWNER; MAX_TIMERS]; // Future woken by each timer slot
+static mut POLLING: usize = 0; // Index of the future being polled
+
+
+static VTABLE: RawWakerVTable = RawWakerVTable::new(waker_clone, waker_wake, waker_wake, waker_drop);
+
+unsafe fn waker_clone(data: *const ()) -> RawWaker {
+    RawWaker::new(data, &VTABLE)
+}
+
+unsafe fn waker_wake(data: *const ()) {
+    wake(data as usize);
+}
+
+unsafe fn waker_drop(_data: *const ()) {}
+
+/// Marks the future `index` as ready and wakes the executor. Safe from interrupt handlers.
+pub fn wake(index: usize) {
+    READY.fetch_or(1 << index, Ordering::SeqCst);
+    task_notify(ASYNC_EXECUTOR_TASK);
+}
+
+/// Polls the futures until they have all completed, then parks the executor task.
+pub fn run<const N: usize>(mut futures: [Pin<&mut dyn Future<Output = ()>>; N]) -> ! {
+    struct Check<const N: usize>;
+    impl<const N: usize> Check<N> {
+        const FITS: () = assert!(N <= MAX_FUTURES);
+    }
+    let () = Check::<N>::FITS;
+
+    let all = if N == MAX_FUTURES { u32::MAX } else { (1u32 << N) - 1 };
+    let mut pending = all;
+    READY.fetch_or(all, Ordering::SeqCst); // Every future is polled once at start
+
+    loop {
+        let ready = READY.swap(0, Ordering::SeqCst) & pending;
+        if ready == 0 {
+            task_notify_wait();
+            continue;
+        }
+
+        for (index, future) in futures.iter_mut().enumerate() {
+            if ready & (1 << index) == 0 {
+                continue;
+            }
+
+            let waker = unsafe { Waker::from_raw(RawWaker::new(index as *const (), &VTABLE)) };
+            let mut cx = Context::from_waker(&waker);
+            unsafe { POLLING = index };
+
+            if future.as_mut().poll(&mut cx).is_ready() {
+                pending &= !(1 << index);
+            }
+        }
+    }
+}
+
+/// Wakes the futures whose `Sleep` ends at `tick_count`. Called from the SysTick handler.
+pub fn on_tick(tick_count: u32) {
+    let mut armed = TIMER_ARMED.load(Ordering::SeqCst);
+    while armed != 0 {
+        let slot = armed.trailing_zeros() as usize;
+        armed &= armed - 1;
+
+        if (tick_count.wrapping_sub(DEADLINES[slot].load(Ordering::SeqCst)) as i32) >= 0 {
+            TIMER_ARMED.fetch_and(!(1 << slot), Ordering::SeqCst);
+            wake(OWNERS[slot].load(Ordering::SeqCst));
+        }
+    }
+}
+
+/// Takes a free timer slot, if any.
+fn claim_timer() -> Option<usize> {
+    let mut used = TIMER_USED.load(Ordering::SeqCst);
+    while used != u32::MAX {
+        let slot = (!used).trailing_zeros() as usize;
+        match TIMER_USED.compare_exchange(used, used | (1 << slot), Ordering::SeqCst, Ordering::SeqCst) {
+            Ok(_) => return Some(slot),
+            Err(current) => used = current,
+        }
+    }
+    None
+}
+
+/// Disarms a timer slot and gives it back.
+fn release_timer(slot: usize) {
+    TIMER_ARMED.fetch_and(!(1 << slot), Ordering::SeqCst);
+    TIMER_USED.fetch_and(!(1 << slot), Ordering::SeqCst);
+}
+
+
+/// Future completing `ticks` system ticks after its first poll.
+pub struct Sleep {
+    ticks: u32,
+    deadline: Option<u32>,
+    timer: Option<usize>, // Timer slot, held while the sleep is pending
+}
+
+/// Sleeps for `ticks` system ticks, same semantics as `task_delay`.
+pub fn sleep(ticks: u32) -> Sleep {
+    Sleep { ticks, deadline: None, timer: None }
+}
+
+impl Future for Sleep {
+    type Output = ();
+
+    fn poll(mut self: Pin<&mut Self>, _cx: &mut Context<'_>) -> Poll<()> {
+        let now = unsafe { GLOBAL_TICK_COUNT };
+        let ticks = self.ticks;
+        let deadline = *self.deadline.get_or_insert(now.wrapping_add(ticks));
+
+        if (now.wrapping_sub(deadline) as i32) >= 0 {
+            if let Some(slot) = self.timer.take() {
+                release_timer(slot);
+            }
+            return Poll::Ready(());
+        }
+
+        let polling = unsafe { POLLING };
+        let slot = match self.timer {
+            Some(slot) => slot,
+            None => match claim_timer() {
+                Some(slot) => *self.timer.insert(slot),
+                None => {
+                    // Every slot is taken : poll again at the next pass instead
+                    wake(polling);
+                    return Poll::Pending;
+                }
+            },
+        };
+
+        // The deadline is written before the timer is armed, SysTick only reads armed slots
+        DEADLINES[slot].store(deadline, Ordering::SeqCst);
+        OWNERS[slot].store(polling, Ordering::SeqCst);
+        TIMER_ARMED.fetch_or(1 << slot, Ordering::SeqCst);
+        Poll::Pending
+    }
+}
+
+impl Drop for Sleep {
+    fn drop(&mut self) {
+        if let Some(slot) = self.timer.take() {
+            release_timer(slot);
+        }
+    }
+}
+
+
+/// Event an interrupt handler can signal to wake a future.
+///
+/// ```ignore
+/// static RX_DONE: Signal = Signal::new();
+/// // in the ISR:     RX_DONE.signal();
+/// // in the future:  RX_DONE.wait().await;
+/// ```
+pub struct Signal {
+    raised: AtomicBool,
+    waiter: AtomicUsize, // Index + 1 of the waiting future, 0 if none
+}
+
+impl Signal {
+    pub const fn new() -> Self {
+        Signal { raised: AtomicBool::new(false), waiter: AtomicUsize::new(0) }
+    }
+
+    /// Raises the signal and wakes the future waiting on it. Safe from interrupt handlers.
+    pub fn signal(&self) {
+        self.raised.store(true, Ordering::SeqCst);
+        let waiter = self.waiter.load(Ordering::SeqCst);
+        if waiter != 0 {
+            wake(waiter - 1);
+        }
+    }
+
+    /// Completes once the signal is raised, consuming it.
+    pub fn wait(&'static self) -> SignalWait {
+        SignalWait { signal: self }
+    }
+}
+
+pub struct SignalWait {
+    signal: &'static Signal,
+}
+
+impl Future for SignalWait {
+    type Output = ();
+
+    fn poll(self: Pin<&mut Self>, _cx: &mut Context<'_>) -> Poll<()> {
+        if self.signal.raised.swap(false, Ordering::SeqCst) {
+            self.signal.waiter.store(0, Ordering::SeqCst);
+            return Poll::Ready(());
+        }
+
+        self.signal.waiter.store(unsafe { POLLING } + 1, Ordering::SeqCst);
+
+        // The signal may have been raised before the waiter was registered
+        if self.signal.raised.swap(false, Ordering::SeqCst) {
+            self.signal.waiter.store(0, Ordering::SeqCst);
+            return Poll::Ready(());
+        }
+        Poll::Pending
+    }
+}
@@ -11,6 +11,7 @@ mod scheduler;
 mod systick;
 mod consts;
 mod fault;
+mod executor;
 
 use crate::scheduler::*;
 use crate::gpio::gpio_init;
@@ -25,11 +26,12 @@ use consts::{SCHEDULER_STACK_START , SYSTICK_TICK_RATE_HZ};
 extern "C" fn main() -> ! {
     //enable_faults();
     gpio_init(); //gpio initialization
+    enable_cycle_counter(); // DWT, for SWITCH_CYCLES_MAX
     init_scheduler_stack(SCHEDULER_STACK_START); //initialize MSP register with the address of scheduler stack start
     configure_systick(SYSTICK_TICK_RATE_HZ);  // HSI clock at 16 MHz and 1s tick rate
 
     init_tasks_stacks();
-    switch_sp_to_psp();
+    unsafe { switch_sp_to_psp() };
     task1_routine();
     // Main loop
     loop {
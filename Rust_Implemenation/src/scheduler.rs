@@ -1,127 +1,301 @@
-use core::{ptr , arch::asm};
+use core::{ptr , arch::{asm, global_asm}, future::Future, pin::{pin, Pin}};
 use crate::consts::*;
-use crate::gpio::{toggle_gpio_d12, toggle_gpio_d13 , toggle_gpio_d14 , toggle_gpio_d15 , delay};
+use crate::gpio::{toggle_gpio_d12, toggle_gpio_d13 , toggle_gpio_d14 , toggle_gpio_d15};
+use crate::executor::{self, sleep};
+use cortex_m::interrupt;
 
-static mut TASKS: [TaskControlBlock; NUM_TASKS] = [
-    TaskControlBlock {psp_value: IDLE_T_STACK_START, block_count: 0, current_state: RUNNING, task_handler: idle_routine},
-    TaskControlBlock {psp_value: TASK1_STACK_START, block_count: 0, current_state: RUNNING, task_handler: task1_routine},
-    TaskControlBlock {psp_value: TASK2_STACK_START, block_count: 0, current_state: RUNNING, task_handler: task2_routine},
-    TaskControlBlock {psp_value: TASK3_STACK_START, block_count: 0, current_state: RUNNING, task_handler: task3_routine},
-    TaskControlBlock {psp_value: TASK4_STACK_START, block_count: 0, current_state: RUNNING, task_handler: task4_routine},
-];
+// Task table, registered at compile time. Slot 0 is the idle task.
+static mut SCHEDULER: Scheduler<NUM_TASKS> = Scheduler::new([
+    TaskControlBlock::new(IDLE_T_STACK_START, idle_routine),
+    TaskControlBlock::new(TASK1_STACK_START, task1_routine),
+    TaskControlBlock::new(TASK2_STACK_START, task2_routine),
+    TaskControlBlock::new(ASYNC_EXEC_STACK_START, async_executor_routine),
+]);
 
+// Core debug cycle counter, read around the scheduler part of PendSV
+const DEMCR: *mut u32 = 0xE000_EDFC as *mut u32;      // Debug exception and monitor control register
+const DWT_CTRL: *mut u32 = 0xE000_1000 as *mut u32;   // DWT control register
+const DWT_CYCCNT: *mut u32 = 0xE000_1004 as *mut u32; // DWT cycle count register
 
+/// Longest `pendsv_switch_context`, in CPU cycles. This is the same span as
+/// `g_switch_cycles_max` in the C version (`update_next_task`), read it with
+/// the debugger (`print SWITCH_CYCLES_MAX`) to compare both switch paths.
+#[no_mangle]
+pub static mut SWITCH_CYCLES_MAX: u32 = 0;
+
+/// The task table. Every caller runs in PendSV, in SysTick or inside a
+/// critical section, so only one reference to it is live at a time.
 #[inline(always)]
-pub fn init_scheduler_stack(stack_start_address: u32) {
-    unsafe {
-        asm!("MSR MSP, R0", in("r0") stack_start_address);
-    }
+unsafe fn scheduler() -> &'static mut Scheduler<NUM_TASKS> {
+    &mut *ptr::addr_of_mut!(SCHEDULER)
 }
 
-#[inline(always)]
-pub fn init_tasks_stacks() {
-    unsafe {
-        for task in 0..NUM_TASKS {
-            let psp =  (TASKS[task].psp_value) as *mut u32; // Get mutable pointer to the task stack
 
-            // Initialize the stack frame
-            let mut psp_frame = psp.sub(1); // Point to the last position of the stack frame
-            *psp_frame = INITIAL_X_PSR; // Set xPSR
+/// Round-robin scheduler over a fixed table of `N` tasks.
+///
+/// `N` is known at compile time, so every method is monomorphized for the
+/// task table in use. `current` is always kept below `N`, which lets the
+/// hot path index the table without bounds checks.
+pub struct Scheduler<const N: usize> {
+    tasks: [TaskControlBlock; N],         // Task table, index 0 is the idle task
+    current: usize,                       // Index of the running task, always < N
+}
+
+impl<const N: usize> Scheduler<N> {
+    // The table must hold the idle task and at least one task
+    const VALID_TABLE: () = assert!(N >= 2);
 
-            psp_frame = psp_frame.sub(1); // Move to the next position
-            *psp_frame = (TASKS[task].task_handler) as u32; // Set the task handler
+    pub const fn new(tasks: [TaskControlBlock; N]) -> Self {
+        let () = Self::VALID_TABLE;
+        Scheduler { tasks, current: 1 }
+    }
+
+    #[inline(always)]
+    fn task(&self, index: usize) -> &TaskControlBlock {
+        // SAFETY: callers only pass indexes below N
+        unsafe { self.tasks.get_unchecked(index) }
+    }
+
+    #[inline(always)]
+    fn task_mut(&mut self, index: usize) -> &mut TaskControlBlock {
+        // SAFETY: callers only pass indexes below N
+        unsafe { self.tasks.get_unchecked_mut(index) }
+    }
 
-            psp_frame = psp_frame.sub(1); // Move to the next position
-            *psp_frame = 0xFFFFFFFD; // Set LR
+    /// Builds the initial exception frame of every task on its stack.
+    pub fn init_stacks(&mut self) {
+        for task in self.tasks.iter_mut() {
+            unsafe {
+                let mut psp_frame = task.psp_value as *mut u32; // Get mutable pointer to the task stack
+
+                psp_frame = psp_frame.sub(1); // Point to the last position of the stack frame
+                *psp_frame = INITIAL_X_PSR; // Set xPSR
+
+                psp_frame = psp_frame.sub(1); // Move to the next position
+                *psp_frame = task.task_handler as u32; // Set the task handler
 
-            // Initialize general purpose registers R12 to R0 with zero
-            for _ in 0..13 {
                 psp_frame = psp_frame.sub(1); // Move to the next position
-                *psp_frame = 0; // Set register value to 0
+                *psp_frame = 0xFFFFFFFD; // Set LR
+
+                // Initialize R12, R3-R0 and the manually saved R11-R4 with zero
+                for _ in 0..13 {
+                    psp_frame = psp_frame.sub(1); // Move to the next position
+                    *psp_frame = 0; // Set register value to 0
+                }
+
+                task.psp_value = psp_frame as u32; // Update the stack pointer for the task
+            }
+        }
+    }
+
+    #[inline(always)]
+    pub fn current_psp(&self) -> u32 {
+        self.task(self.current).psp_value
+    }
+
+    /// Makes the next runnable task current, falling back to the idle task.
+    #[inline(always)]
+    fn select_next(&mut self) {
+        let mut next = self.current;
+        for _ in 0..N {
+            next += 1;
+            if next == N {
+                next = 0;
             }
 
-            TASKS[task].psp_value = psp_frame as u32; // Update the stack pointer for the task
+            // Skip the idle task, it only runs when nothing else can
+            if next != 0 && self.task(next).current_state == RUNNING {
+                self.current = next;
+                return;
+            }
+        }
+        self.current = 0;
+    }
+
+    /// Saves the stack pointer of the outgoing task and returns the one of the incoming task.
+    #[inline(always)]
+    pub fn switch_context(&mut self, psp: u32) -> u32 {
+        let current = self.current;
+        self.task_mut(current).psp_value = psp;
+        self.select_next();
+        self.current_psp()
+    }
+
+    /// Blocks the current task until the tick count reaches `tick_count + ticks`.
+    #[inline(always)]
+    pub fn delay_current(&mut self, tick_count: u32, ticks: u32) -> bool {
+        if self.current == 0 {
+            return false;
+        }
+        let current = self.current;
+        let task = self.task_mut(current);
+        task.block_count = tick_count + ticks;
+        task.current_state = BLOCKED;
+        true
+    }
+
+    /// Consumes a pending notification, or puts the current task in the waiting state.
+    /// Returns true when the task has to be switched out.
+    #[inline(always)]
+    pub fn wait_current(&mut self) -> bool {
+        let current = self.current;
+        let task = self.task_mut(current);
+        if current == 0 || task.notify_pending {
+            task.notify_pending = false;
+            return false;
+        }
+        task.current_state = WAITING;
+        true
+    }
+
+    /// Clears the notification of the current task once it has been woken up.
+    #[inline(always)]
+    pub fn clear_notification(&mut self) {
+        let current = self.current;
+        self.task_mut(current).notify_pending = false;
+    }
+
+    /// Marks a notification as pending for `index`, waking it up if it is waiting.
+    /// Returns true when the task was waiting.
+    #[inline(always)]
+    pub fn notify(&mut self, index: usize) -> bool {
+        if index >= N {
+            return false;
+        }
+        let task = self.task_mut(index);
+        task.notify_pending = true;
+        if task.current_state == WAITING {
+            task.current_state = RUNNING;
+            return true;
+        }
+        false
+    }
+
+    /// Moves to the runnable state every blocked task whose delay ends at `tick_count`.
+    #[inline(always)]
+    pub fn unblock_expired(&mut self, tick_count: u32) {
+        for task in self.tasks.iter_mut() {
+            if task.current_state == BLOCKED && task.block_count == tick_count {
+                task.current_state = RUNNING;
+            }
         }
     }
 }
 
 
+// Context switch. Only R4-R11 have to be saved by hand, the core stacks the
+// rest on exception entry. EXC_RETURN is kept in R4 (callee-saved, already
+// stored in the frame) across the call, so nothing is pushed on the MSP.
+global_asm!(
+    ".section .text.PendSV, \"ax\", %progbits",
+    ".global PendSV",
+    ".type PendSV, %function",
+    ".thumb_func",
+    "PendSV:",
+    "    MRS   R0, PSP",
+    "    STMDB R0!, {{R4-R11}}",
+    "    MOV   R4, LR",
+    "    BL    pendsv_switch_context",
+    "    MOV   LR, R4",
+    "    LDMIA R0!, {{R4-R11}}",
+    "    MSR   PSP, R0",
+    "    BX    LR",
+    ".size PendSV, . - PendSV",
+);
+
+// Loads the PSP of the first task and makes thread mode use it.
+global_asm!(
+    ".section .text.switch_sp_to_psp, \"ax\", %progbits",
+    ".global switch_sp_to_psp",
+    ".type switch_sp_to_psp, %function",
+    ".thumb_func",
+    "switch_sp_to_psp:",
+    "    PUSH  {{R4, LR}}",
+    "    BL    current_task_psp",
+    "    MSR   PSP, R0",
+    "    POP   {{R4, LR}}",
+    "    MOVS  R0, #0x02",
+    "    MSR   CONTROL, R0",
+    "    ISB",
+    "    BX    LR",
+    ".size switch_sp_to_psp, . - switch_sp_to_psp",
+);
 
-pub unsafe fn get_psp_value() -> u32 {
-    TASKS[C_TASK].psp_value
+extern "C" {
+    pub fn switch_sp_to_psp();
 }
 
-pub unsafe fn set_psp_value(task_psp: u32) {
-    TASKS[C_TASK].psp_value = task_psp;
+#[no_mangle]
+extern "C" fn pendsv_switch_context(psp: u32) -> u32 {
+    unsafe {
+        let start = ptr::read_volatile(DWT_CYCCNT);
+        let next_psp = scheduler().switch_context(psp);
+        let cycles = ptr::read_volatile(DWT_CYCCNT).wrapping_sub(start);
+
+        let max = ptr::addr_of_mut!(SWITCH_CYCLES_MAX);
+        if cycles > *max {
+            *max = cycles;
+        }
+        next_psp
+    }
 }
 
-pub fn switch_sp_to_psp() {
+#[no_mangle]
+extern "C" fn current_task_psp() -> u32 {
+    unsafe { scheduler().current_psp() }
+}
 
+/// Starts the DWT cycle counter used to measure the context switch.
+pub fn enable_cycle_counter() {
     unsafe {
-        asm!(
-            "PUSH {{LR}}",
-            options(nostack),
-        );
-    
-        get_psp_value();
-    
-        //Move the PSP value from R0 to the Process Stack Pointer
-        asm!(
-            "MSR PSP, R0",
-            options(nostack),
-        );
-    
-        ///Restore the link register (LR) from the stack
-        asm!(
-            "POP {{LR}}",
-            options(nostack),
-        );
-    
-        ///SP to PSP by updating CONTROL register 
-        asm!(
-            "MOV R0, #0x02",
-            "MSR CONTROL, R0",
-            options(nostack),
-        );
-    
-        asm!(
-            "BX LR",
-            options(nostack),
-        );
-    }
-}
-
-pub fn update_next_task() {
+        ptr::write_volatile(DEMCR, ptr::read_volatile(DEMCR) | (1 << 24)); // TRCENA
+        ptr::write_volatile(DWT_CTRL, ptr::read_volatile(DWT_CTRL) | 1);   // CYCCNTENA
+    }
+}
+
+
+#[inline(always)]
+pub fn init_scheduler_stack(stack_start_address: u32) {
     unsafe {
-        let mut found_task = false;
-        for _ in 0..NUM_TASKS {
-            C_TASK = (C_TASK + 1) % NUM_TASKS;
-            
-            // Check if the selected task is running and is not the idle task
-            if TASKS[C_TASK].current_state == RUNNING && C_TASK != 0 {
-                found_task = true;
-                break;
-            }
-        }
-        
-        // If no running tasks were found, set to idle task
-        if !found_task {
-            C_TASK = 0;
-        }
+        asm!("MSR MSP, R0", in("r0") stack_start_address);
+    }
+}
+
+pub fn init_tasks_stacks() {
+    unsafe {
+        scheduler().init_stacks();
     }
-    
 }
 
 pub fn task_delay(tick_to_delay: u32) {
     unsafe {
-        if C_TASK != 0 {
-            TASKS[C_TASK].block_count = GLOBAL_TICK_COUNT + tick_to_delay ;
-            TASKS[C_TASK].current_state = BLOCKED;
+        if scheduler().delay_current(GLOBAL_TICK_COUNT, tick_to_delay) {
             trig_pendsv();
         }
     }
 }
 
+/// Blocks the current task until `task_notify` is called on it.
+/// Returns at once if a notification is already pending.
+pub fn task_notify_wait() {
+    interrupt::free(|_| unsafe {
+        if scheduler().wait_current() {
+            trig_pendsv(); // taken as soon as interrupts are enabled again
+        }
+    });
+    interrupt::free(|_| unsafe { scheduler().clear_notification() });
+}
+
+/// Notifies a task, waking it up if it waits in `task_notify_wait`.
+/// Safe to call from interrupt handlers.
+pub fn task_notify(index: usize) {
+    interrupt::free(|_| unsafe {
+        if scheduler().notify(index) {
+            trig_pendsv();
+        }
+    });
+}
+
 pub fn trig_pendsv() {
     let icsr = 0xE000_ED04 as *mut u32;
     unsafe {
@@ -131,13 +305,7 @@ pub fn trig_pendsv() {
 
 pub fn check_blocked_tasks() {
     unsafe {
-        for task in 0..NUM_TASKS {
-            if TASKS[task].current_state == BLOCKED {
-                if TASKS[task].block_count == GLOBAL_TICK_COUNT {
-                    TASKS[task].current_state = RUNNING ;
-                }
-            }
-        }
+        scheduler().unblock_expired(GLOBAL_TICK_COUNT);
     }
 }
 
@@ -155,21 +323,28 @@ fn task2_routine() -> () {
         task_delay(4);
     }
 }
-fn task3_routine() -> () {
+async fn blink_d14() {
     loop {
         toggle_gpio_d14();
-        task_delay(6);
+        sleep(6).await;
     }
 }
-fn task4_routine() -> () {
+async fn blink_d15() {
     loop {
         toggle_gpio_d15();
-        task_delay(8);
+        sleep(8).await;
     }
 }
 
+// The futures live in this frame for ever, on the executor stack
+fn async_executor_routine() -> () {
+    let blink14 = pin!(blink_d14());
+    let blink15 = pin!(blink_d15());
+    executor::run([blink14 as Pin<&mut dyn Future<Output = ()>>, blink15]);
+}
+
 fn idle_routine() -> () {
     loop {
-        
+
     }
 }
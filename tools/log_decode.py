@@ -0,0 +1,155 @@
+#!/usr/bin/env python3
+"""
+Decoder of the deferred binary log of the Embedded Scheduler Project.
+
+The firmware sends log records (see `log.h`) as binary frames mixed with the
+console text on USART2. This tool passes the text through and rebuilds each
+record from the format string found at the recorded address in the ELF file
+that runs on the target.
+
+Usage :
+
+    tools/log_decode.py C_Implementation/Debug/scheduler.elf capture.bin
+    stty -F /dev/ttyACM0 115200 raw && tools/log_decode.py scheduler.elf /dev/ttyACM0
+
+The ELF must be the exact build running on the target, format addresses
+change with every build.
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+LOG_FRAME_SYNC = 0x00
+LOG_HEADER_WORDS = 3
+PROFILER_FRAME_SYNC = 0x01   # profiler.h, skipped here, see tools/profile.py
+PROFILER_SAMPLE_BYTES = 12
+
+DEFAULT_NAMES = ["idle", "task1", "task2", "task3", "task4", "jobs", "shell", "dyn7", "dyn8", "isr"]
+
+SHT_PROGBITS = 1
+SHF_ALLOC = 0x2
+
+CONVERSION = re.compile(r"%([-+ #0]*)(\d*)(?:\.(\d+))?(?:hh|h|ll|l|z|j|t)?([diouxXcsp%])")
+
+
+class Elf:
+    """Loaded sections of an ELF32 little endian file, by address."""
+
+    def __init__(self, path):
+        with open(path, "rb") as elf:
+            data = elf.read()
+        if data[:4] != b"\x7fELF" or data[4] != 1 or data[5] != 1:
+            sys.exit("%s: not a 32-bit little endian ELF file" % path)
+
+        shoff, = struct.unpack_from("<I", data, 0x20)
+        shentsize, shnum = struct.unpack_from("<HH", data, 0x2E)
+        self.sections = []
+        for index in range(shnum):
+            _, sh_type, flags, addr, offset, size = struct.unpack_from(
+                "<IIIIII", data, shoff + index * shentsize)
+            if sh_type == SHT_PROGBITS and flags & SHF_ALLOC and size != 0:
+                self.sections.append((addr, data[offset:offset + size]))
+
+    def string(self, address):
+        for start, content in self.sections:
+            if start <= address < start + len(content):
+                end = content.find(b"\0", address - start)
+                if end < 0:
+                    end = len(content)
+                return content[address - start:end].decode("latin-1")
+        return None
+
+
+def format_record(elf, fmt, args):
+    """Applies a C format string to the 32-bit arguments of a record."""
+    args = list(args)
+
+    def convert(match):
+        flags, width, precision, kind = match.groups()
+        if kind == "%":
+            return "%"
+        if not args:
+            return "<missing>"
+        value = args.pop(0)
+        spec = "%" + flags + width + ("." + precision if precision else "")
+        if kind in "di":
+            return (spec + "d") % (value - (1 << 32) if value & 0x80000000 else value)
+        if kind == "u":
+            return (spec + "d") % value
+        if kind in "oxX":
+            return (spec + kind) % value
+        if kind == "c":
+            return (spec + "c") % chr(value & 0xFF)
+        if kind == "p":
+            return "0x%08x" % value
+        text = elf.string(value)
+        return (spec + "s") % (text if text is not None else "<0x%08x>" % value)
+
+    return CONVERSION.sub(convert, fmt)
+
+
+def decode(elf, stream, names, out):
+    line_start = True
+
+    while True:
+        byte = stream.read(1)
+        if not byte:
+            return
+        if byte[0] == PROFILER_FRAME_SYNC:
+            count = stream.read(1)
+            if count:
+                stream.read(PROFILER_SAMPLE_BYTES * count[0])
+            continue
+        if byte[0] != LOG_FRAME_SYNC:
+            out.write(byte.decode("latin-1"))
+            line_start = byte in (b"\n", b"\r")
+            continue
+        if not line_start:
+            out.write("\n")
+            line_start = True
+
+        count = stream.read(1)
+        if not count:
+            return
+        payload = stream.read(4 * count[0])
+        if len(payload) < 4 * count[0] or count[0] < LOG_HEADER_WORDS:
+            out.write("\n<truncated log frame>\n")
+            continue
+
+        words = struct.unpack("<%dI" % count[0], payload)
+        address, header, timestamp = words[:LOG_HEADER_WORDS]
+        ring = header >> 8
+        args = words[LOG_HEADER_WORDS:LOG_HEADER_WORDS + (header & 0xFF)]
+        name = names[ring] if ring < len(names) else "ring%d" % ring
+
+        if address == 0:
+            text = "<%d records dropped>" % (args[0] if args else 0)
+        else:
+            fmt = elf.string(address)
+            text = format_record(elf, fmt, args) if fmt is not None else \
+                "<unknown format 0x%08x, wrong ELF?>" % address
+        out.write("[%10u us] %-6s %s\n" % (timestamp, name, text.rstrip("\r\n")))
+        out.flush()
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode the deferred binary log.")
+    parser.add_argument("elf", help="ELF file running on the target")
+    parser.add_argument("input", nargs="?", help="capture file or serial device, default stdin")
+    parser.add_argument("--names", default=",".join(DEFAULT_NAMES),
+                        help="comma separated task names by ring index, the last one is the ISR ring")
+    args = parser.parse_args()
+
+    elf = Elf(args.elf)
+    stream = open(args.input, "rb", buffering=0) if args.input else sys.stdin.buffer
+    try:
+        decode(elf, stream, args.names.split(","), sys.stdout)
+    except KeyboardInterrupt:
+        pass
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,150 @@
+#!/usr/bin/env python3
+"""
+Symbolizer of the PC-sampling profiler of the Embedded Scheduler Project.
+
+Reads the samples sent by a build with `-DPROFILER_ENABLE=1` (see
+`profiler.h`) from a console capture, maps every sampled PC to a function of
+the ELF file and prints a flat profile per task. With `--folded`, it also
+writes folded stacks (`task;caller;function count`) for flamegraph.pl or
+speedscope. The caller comes from the stacked LR. It is exact when the
+sample hit a leaf function, otherwise it may name a function called
+earlier, so the stacks are two levels deep at most.
+
+Usage :
+
+    tools/profile.py C_Implementation/Debug/scheduler.elf capture.bin
+    tools/profile.py scheduler.elf capture.bin --folded profile.folded --top 10
+"""
+
+import argparse
+import bisect
+import collections
+import struct
+import sys
+
+LOG_FRAME_SYNC = 0x00        # log.h, skipped here
+PROFILER_FRAME_SYNC = 0x01   # profiler.h
+PROFILER_SAMPLE_BYTES = 12
+
+DEFAULT_NAMES = ["idle", "task1", "task2", "task3", "task4", "jobs", "shell", "dyn7", "dyn8"]
+
+SHT_SYMTAB = 2
+STT_FUNC = 2
+
+
+class Symbols:
+    """Function symbols of an ELF32 little endian file, by address."""
+
+    def __init__(self, path):
+        with open(path, "rb") as elf:
+            data = elf.read()
+        if data[:4] != b"\x7fELF" or data[4] != 1 or data[5] != 1:
+            sys.exit("%s: not a 32-bit little endian ELF file" % path)
+
+        shoff, = struct.unpack_from("<I", data, 0x20)
+        shentsize, shnum = struct.unpack_from("<HH", data, 0x2E)
+        headers = [struct.unpack_from("<IIIIIIIIII", data, shoff + index * shentsize)
+                   for index in range(shnum)]
+
+        functions = {}
+        for header in headers:
+            if header[1] != SHT_SYMTAB:
+                continue
+            strtab = headers[header[6]]
+            strings = data[strtab[4]:strtab[4] + strtab[5]]
+            for offset in range(header[4], header[4] + header[5], 16):
+                name, value, size, info, _, shndx = struct.unpack_from("<IIIBBH", data, offset)
+                if info & 0xF != STT_FUNC or shndx == 0:
+                    continue
+                end = strings.find(b"\0", name)
+                functions[value & ~1] = (strings[name:end].decode("latin-1"), size)
+
+        self.starts = sorted(functions)
+        self.functions = [functions[start] for start in self.starts]
+        if not self.starts:
+            sys.exit("%s: no function symbols, is the ELF stripped?" % path)
+
+    def lookup(self, address):
+        address &= ~1
+        index = bisect.bisect_right(self.starts, address) - 1
+        if index < 0:
+            return None
+        name, size = self.functions[index]
+        if size != 0 and address >= self.starts[index] + size:
+            return None
+        return name
+
+
+def read_samples(stream):
+    """Yields (pc, lr, task) from a capture, skipping console text and log frames."""
+    while True:
+        byte = stream.read(1)
+        if not byte:
+            return
+        if byte[0] not in (LOG_FRAME_SYNC, PROFILER_FRAME_SYNC):
+            continue
+
+        count = stream.read(1)
+        if not count:
+            return
+        if byte[0] == LOG_FRAME_SYNC:
+            stream.read(4 * count[0])
+            continue
+
+        payload = stream.read(PROFILER_SAMPLE_BYTES * count[0])
+        for offset in range(0, len(payload) - PROFILER_SAMPLE_BYTES + 1, PROFILER_SAMPLE_BYTES):
+            yield struct.unpack_from("<III", payload, offset)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Per-task profiles from PC samples.")
+    parser.add_argument("elf", help="ELF file running on the target")
+    parser.add_argument("input", nargs="?", help="capture file or serial device, default stdin")
+    parser.add_argument("--names", default=",".join(DEFAULT_NAMES),
+                        help="comma separated task names by task index")
+    parser.add_argument("--folded", metavar="FILE", help="write folded stacks to FILE")
+    parser.add_argument("--top", type=int, default=20, help="functions listed per task")
+    args = parser.parse_args()
+
+    symbols = Symbols(args.elf)
+    names = args.names.split(",")
+    stream = open(args.input, "rb", buffering=0) if args.input else sys.stdin.buffer
+
+    flat = collections.defaultdict(collections.Counter)
+    folded = collections.Counter()
+    total = 0
+    try:
+        for pc, lr, task in read_samples(stream):
+            task_name = names[task] if task < len(names) else "task%d" % task
+            function = symbols.lookup(pc) or "0x%08x" % pc
+            # EXC_RETURN values are not code addresses
+            caller = symbols.lookup(lr) if lr < 0xF0000000 else None
+
+            flat[task_name][function] += 1
+            stack = [task_name] + ([caller] if caller and caller != function else []) + [function]
+            folded[";".join(stack)] += 1
+            total += 1
+    except KeyboardInterrupt:
+        pass
+
+    if total == 0:
+        print("no samples, was the firmware built with -DPROFILER_ENABLE=1?")
+        return 1
+
+    for task_name, functions in sorted(flat.items(), key=lambda item: -sum(item[1].values())):
+        task_total = sum(functions.values())
+        print("%s : %d samples, %.1f %% of the CPU" % (task_name, task_total, 100.0 * task_total / total))
+        for function, count in functions.most_common(args.top):
+            print("  %6.1f %%  %7d  %s" % (100.0 * count / task_total, count, function))
+        print()
+
+    if args.folded:
+        with open(args.folded, "w") as out:
+            for stack, count in sorted(folded.items()):
+                out.write("%s %d\n" % (stack, count))
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
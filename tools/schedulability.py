@@ -0,0 +1,341 @@
+#!/usr/bin/env python3
+"""
+Offline schedulability analysis for the Embedded Scheduler Project.
+
+Reads a task set description (JSON) and, optionally, captures of the shell
+`top` view taken on target, then checks the task set under:
+
+- fixed priority scheduling (rate monotonic when no priority is given) with
+  response-time analysis,
+- EDF with the processor demand criterion.
+
+Both analyses account for the scheduler's own costs : every system tick runs
+SysTick_Handler and requests a context switch, and every job is charged two
+context switches (switched in when released, switched out when it blocks).
+
+Task set format :
+
+    {
+      "cpu_hz": 16000000,                 # optional, default from main.h
+      "tick_rate_hz": 1000,               # optional, default from main.h
+      "overheads": {                      # optional, measured by the shell
+        "tick_cycles": 180,
+        "switch_cycles": 120
+      },
+      "tasks": [
+        {
+          "name": "task1",                # matches the shell NAME column
+          "period_ticks": 2,              # or "period_us"
+          "deadline_ticks": 2,            # optional, or "deadline_us", default period
+          "priority": 4,                  # optional, higher runs first
+          "threshold": 5,                 # optional preemption threshold, default priority
+          "wcet_us": 40,                  # optional when a capture provides it
+          "blocking_us": 5,               # optional, longest critical section of the task
+          "stack_bytes": 1024             # optional, default TASK_STACK_SIZE
+        }
+      ]
+    }
+
+Usage :
+
+    tools/schedulability.py tools/taskset_example.json
+    tools/schedulability.py taskset.json --measurements top.log --tick-rate 1000 --cpu-hz 16000000
+
+The exit status is 0 when the task set is schedulable under every selected
+policy, 1 otherwise.
+"""
+
+import argparse
+import json
+import math
+import os
+import re
+import sys
+
+# Cortex-M4 exception entry and return with zero flash wait states, charged
+# on top of the measured handler bodies
+EXCEPTION_CYCLES = 24
+
+# Register save and restore in PendSV_Handler around update_next_task
+PENDSV_ASM_CYCLES = 30
+
+STACK_HEADROOM_WARNING = 0.9
+
+DEFAULT_MAIN_H = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                              "..", "C_Implementation", "Inc", "main.h")
+
+
+def read_defines(path):
+    """Returns the integer #define values of a header."""
+    defines = {}
+    try:
+        with open(path) as header:
+            for line in header:
+                match = re.match(r"\s*#define\s+(\w+)\s+\(?(\d+)U?\)?", line)
+                if match:
+                    defines[match.group(1)] = int(match.group(2))
+    except OSError:
+        pass
+    return defines
+
+
+def read_measurements(paths):
+    """
+    Extracts the overheads and per-task figures from captures of the shell
+    `top` view. The worst value over all refreshes is kept.
+    """
+    overheads = {"tick_cycles": 0, "switch_cycles": 0}
+    tasks = {}
+    overhead_line = re.compile(r"overhead tick (\d+) cyc\s+switch (\d+) cyc")
+    task_line = re.compile(r"^\s*\d+\s+(\S+)\s+\S+\s+[\d.]+\s+(\d+)/(\d+)\s+(\d+)\s*$")
+
+    for path in paths:
+        with open(path, errors="replace") as capture:
+            for line in capture:
+                match = overhead_line.search(line)
+                if match:
+                    overheads["tick_cycles"] = max(overheads["tick_cycles"], int(match.group(1)))
+                    overheads["switch_cycles"] = max(overheads["switch_cycles"], int(match.group(2)))
+                    continue
+                match = task_line.match(line)
+                if match:
+                    entry = tasks.setdefault(match.group(1), {"stack_used": 0, "wcet_us": 0})
+                    entry["stack_used"] = max(entry["stack_used"], int(match.group(2)))
+                    entry["stack_bytes"] = int(match.group(3))
+                    entry["wcet_us"] = max(entry["wcet_us"], int(match.group(4)))
+    return overheads, tasks
+
+
+def us_to_cycles(us, cpu_hz):
+    return int(math.ceil(us * cpu_hz / 1e6))
+
+
+def cycles_to_us(cycles, cpu_hz):
+    return cycles * 1e6 / cpu_hz
+
+
+class Task:
+    def __init__(self, name, period, deadline, cost, blocking, priority, threshold, stack_used, stack_bytes):
+        self.name = name
+        self.period = period          # cycles
+        self.deadline = deadline      # cycles
+        self.cost = cost              # cycles, context switches included
+        self.blocking = blocking      # cycles
+        self.priority = priority
+        self.threshold = threshold
+        self.stack_used = stack_used
+        self.stack_bytes = stack_bytes
+        self.response = None
+
+
+def build_tasks(config, measured, cpu_hz, tick_rate_hz, switch_cost, default_stack, warnings):
+    tick_cycles = cpu_hz // tick_rate_hz
+    tasks = []
+
+    for entry in config["tasks"]:
+        name = entry["name"]
+        sample = measured.get(name, {})
+
+        if "period_ticks" in entry:
+            period = entry["period_ticks"] * tick_cycles
+        else:
+            # task_delay counts whole ticks : a period that is not a multiple
+            # of the tick is released on the tick before it, at the earliest
+            period_ticks = int(entry["period_us"] * tick_rate_hz // 1000000)
+            if period_ticks * 1000000 != entry["period_us"] * tick_rate_hz:
+                warnings.append("%s: period %g us is not a whole number of ticks" % (name, entry["period_us"]))
+            if period_ticks == 0:
+                warnings.append("%s: period shorter than one tick, using one tick" % name)
+                period_ticks = 1
+            period = period_ticks * tick_cycles
+
+        if "deadline_ticks" in entry:
+            deadline = entry["deadline_ticks"] * tick_cycles
+        elif "deadline_us" in entry:
+            deadline = us_to_cycles(entry["deadline_us"], cpu_hz)
+        else:
+            deadline = period
+
+        wcet_us = max(entry.get("wcet_us", 0), sample.get("wcet_us", 0))
+        if wcet_us == 0:
+            warnings.append("%s: no WCET given or measured" % name)
+
+        tasks.append(Task(name, period, deadline,
+                          us_to_cycles(wcet_us, cpu_hz) + 2 * switch_cost,
+                          us_to_cycles(entry.get("blocking_us", 0), cpu_hz),
+                          entry.get("priority"),
+                          entry.get("threshold", entry.get("priority")),
+                          sample.get("stack_used"),
+                          entry.get("stack_bytes", sample.get("stack_bytes", default_stack))))
+    return tasks
+
+
+def fixed_priority_order(tasks):
+    """Explicit priorities when all tasks have one, rate monotonic otherwise."""
+    if all(task.priority is not None for task in tasks):
+        return sorted(tasks, key=lambda task: -task.priority), "fixed priority"
+    return sorted(tasks, key=lambda task: (task.period, task.deadline)), "rate monotonic"
+
+
+def response_time_analysis(ordered, tick_period, tick_cost):
+    """
+    R = C + B + sum over higher or equal priority tasks of ceil(R / Tj) * Cj
+          + ceil(R / Ttick) * tick cost
+    iterated to a fixed point, or until R exceeds the deadline. A preemption
+    threshold is accounted as blocking, which is safe but pessimistic.
+    """
+    schedulable = True
+
+    for index, task in enumerate(ordered):
+        # Equal priorities time slice, so they interfere like higher ones
+        interfering = [other for other in ordered if other is not task and
+                       (ordered.index(other) < index or
+                        (other.priority is not None and other.priority == task.priority))]
+        # A lower priority task inside a critical section delays the release,
+        # one whose preemption threshold reaches our priority runs to completion
+        lower = [other for other in ordered[index + 1:] if other not in interfering]
+        blocking = max([0] + [other.blocking for other in lower] +
+                       [other.cost for other in lower
+                        if task.priority is not None and other.threshold is not None and
+                        other.threshold >= task.priority])
+        response = task.cost + blocking
+
+        while True:
+            demand = (task.cost + blocking +
+                      sum(int(math.ceil(response / other.period)) * other.cost for other in interfering) +
+                      int(math.ceil(response / tick_period)) * tick_cost)
+            if demand == response or demand > task.deadline:
+                response = demand
+                break
+            response = demand
+
+        task.response = response
+        if response > task.deadline:
+            schedulable = False
+
+    return schedulable
+
+
+def edf_analysis(tasks, tick_period, tick_cost):
+    """
+    Processor demand criterion : for every absolute deadline t in the first
+    synchronous busy period, the work due by t, plus the longest critical
+    section of a task with a later deadline, must fit in t.
+    Returns (schedulable, utilization, first failing t or None).
+    """
+    utilization = sum(task.cost / task.period for task in tasks) + tick_cost / tick_period
+    if utilization > 1:
+        return False, utilization, None
+
+    # Synchronous busy period, bounded by the hyperperiod
+    hyperperiod = tick_period
+    for task in tasks:
+        hyperperiod = hyperperiod * task.period // math.gcd(hyperperiod, task.period)
+    busy = sum(task.cost for task in tasks) + tick_cost
+    while True:
+        demand = (sum(int(math.ceil(busy / task.period)) * task.cost for task in tasks) +
+                  int(math.ceil(busy / tick_period)) * tick_cost)
+        if demand == busy or demand > hyperperiod:
+            busy = min(demand, hyperperiod + max(task.deadline for task in tasks))
+            break
+        busy = demand
+
+    points = sorted({deadline
+                     for task in tasks
+                     for deadline in range(task.deadline, busy + 1, task.period)})
+    for t in points:
+        demand = (sum(((t - task.deadline) // task.period + 1) * task.cost
+                      for task in tasks if t >= task.deadline) +
+                  int(math.ceil(t / tick_period)) * tick_cost +
+                  max([0] + [task.blocking for task in tasks if task.deadline > t]))
+        if demand > t:
+            return False, utilization, t
+
+    return True, utilization, None
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Offline schedulability analysis of a task set.")
+    parser.add_argument("taskset", help="task set description (JSON)")
+    parser.add_argument("--measurements", action="append", default=[], metavar="CAPTURE",
+                        help="capture of the shell `top` output, may be repeated")
+    parser.add_argument("--tick-rate", type=int, help="SYSTEM_TICK_RATE_HZ to analyse")
+    parser.add_argument("--cpu-hz", type=int, help="CPU clock in Hz")
+    parser.add_argument("--policy", choices=["rm", "edf", "both"], default="both")
+    parser.add_argument("--main-h", default=DEFAULT_MAIN_H, help="main.h providing the defaults")
+    args = parser.parse_args()
+
+    with open(args.taskset) as taskset:
+        config = json.load(taskset)
+    defines = read_defines(args.main_h)
+    measured_overheads, measured_tasks = read_measurements(args.measurements)
+
+    cpu_hz = args.cpu_hz or config.get("cpu_hz") or defines.get("HSI_CLOCK_FREQUENCY_HZ")
+    tick_rate_hz = args.tick_rate or config.get("tick_rate_hz") or defines.get("SYSTEM_TICK_RATE_HZ")
+    if not cpu_hz or not tick_rate_hz:
+        sys.exit("the CPU clock and the tick rate must be given, or found in main.h")
+
+    overheads = config.get("overheads", {})
+    tick_handler = max(overheads.get("tick_cycles", 0), measured_overheads["tick_cycles"])
+    switch_handler = max(overheads.get("switch_cycles", 0), measured_overheads["switch_cycles"])
+    warnings = []
+    if tick_handler == 0 or switch_handler == 0:
+        warnings.append("scheduler overheads not measured, only the exception costs are charged")
+
+    switch_cost = switch_handler + EXCEPTION_CYCLES + PENDSV_ASM_CYCLES
+    tick_cost = tick_handler + EXCEPTION_CYCLES + switch_cost   # every tick requests PendSV
+    tick_period = cpu_hz // tick_rate_hz
+
+    tasks = build_tasks(config, measured_tasks, cpu_hz, tick_rate_hz, switch_cost,
+                        defines.get("TASK_STACK_SIZE", 0), warnings)
+
+    print("CPU %d Hz, tick %d Hz (%d cycles), tick cost %d cycles, switch cost %d cycles"
+          % (cpu_hz, tick_rate_hz, tick_period, tick_cost, switch_cost))
+    print("scheduler load %.2f %%" % (100.0 * tick_cost / tick_period))
+    if tick_cost >= tick_period:
+        print("the tick handler alone does not fit in one tick period")
+        return 1
+
+    result = True
+
+    if args.policy in ("rm", "both"):
+        ordered, label = fixed_priority_order(tasks)
+        schedulable = response_time_analysis(ordered, tick_period, tick_cost)
+        result = result and schedulable
+        print("\n%s response-time analysis" % label)
+        print("  %-10s %4s %12s %12s %12s %12s" % ("task", "prio", "T us", "D us", "C us", "R us"))
+        for task in ordered:
+            print("  %-10s %4s %12.1f %12.1f %12.1f %12.1f %s"
+                  % (task.name, "-" if task.priority is None else task.priority,
+                     cycles_to_us(task.period, cpu_hz), cycles_to_us(task.deadline, cpu_hz),
+                     cycles_to_us(task.cost, cpu_hz), cycles_to_us(task.response, cpu_hz),
+                     "ok" if task.response <= task.deadline else "MISS"))
+        print("  %s" % ("schedulable" if schedulable else "NOT schedulable"))
+
+    if args.policy in ("edf", "both"):
+        schedulable, utilization, failure = edf_analysis(tasks, tick_period, tick_cost)
+        result = result and schedulable
+        print("\nEDF processor demand analysis")
+        print("  utilization %.2f %%" % (100.0 * utilization))
+        if failure is not None:
+            print("  demand exceeds supply at t = %.1f us" % cycles_to_us(failure, cpu_hz))
+        print("  %s" % ("schedulable" if schedulable else "NOT schedulable"))
+
+    stack_lines = []
+    for task in tasks:
+        if task.stack_used is not None and task.stack_bytes:
+            ratio = task.stack_used / task.stack_bytes
+            stack_lines.append("  %-10s %5d/%d%s" % (task.name, task.stack_used, task.stack_bytes,
+                                                   "  low headroom" if ratio >= STACK_HEADROOM_WARNING else ""))
+    if stack_lines:
+        print("\nstack high-water marks")
+        print("\n".join(stack_lines))
+
+    for warning in warnings:
+        print("warning: %s" % warning, file=sys.stderr)
+
+    return 0 if result else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())